@@ -24,15 +24,13 @@
 
 ; *------- <<< Use Configuration Wizard in Context Menu >>> ------------------
 
-; <h> Stack Configuration
-;   <o> Stack Size (in Bytes) <0x0-0xFFFFFFFF:8>
-; </h>
+; Stack is ARM_LIB_STACK region of LPC812_flash.scf (Stack_Size there), used from reset,
+; Reset_Handler paints it with STACK_PAINT so stack.c can find the high-water mark
 
-Stack_Size      EQU     0x00000100
+STACK_PAINT     EQU     0xC5C5C5C5                    ; HAL_STACK_PAINT of hal.h
 
-                AREA    STACK, NOINIT, READWRITE, ALIGN=3
-Stack_Mem       SPACE   Stack_Size
-__initial_sp
+                IMPORT  |Image$$ARM_LIB_STACK$$ZI$$Base|
+                IMPORT  |Image$$ARM_LIB_STACK$$ZI$$Limit|
 
 
 ; <h> Heap Configuration
@@ -60,7 +58,7 @@ __heap_limit
                 AREA    RESET, DATA, READONLY
                 EXPORT  __Vectors
 
-__Vectors       DCD     __initial_sp               ; Top of Stack
+__Vectors       DCD     |Image$$ARM_LIB_STACK$$ZI$$Limit| ; Top of Stack
                 DCD     Reset_Handler              ; Reset Handler
                 DCD     NMI_Handler                ; NMI Handler
                 DCD     HardFault_Handler          ; Hard Fault Handler
@@ -132,6 +130,13 @@ Reset_Handler   PROC
                 EXPORT  Reset_Handler              [WEAK]
                 IMPORT  SystemInit
                 IMPORT  __main
+                LDR     R0, =|Image$$ARM_LIB_STACK$$ZI$$Base| ; paint stack, nothing is pushed yet
+                LDR     R1, =|Image$$ARM_LIB_STACK$$ZI$$Limit|
+                LDR     R2, =STACK_PAINT
+StackPaint      STR     R2, [R0]
+                ADDS    R0, R0, #4
+                CMP     R0, R1
+                BLO     StackPaint
                 LDR     R0, =SystemInit
                 BLX     R0
                 LDR     R0, =__main
@@ -220,7 +225,6 @@ PIN_INT7_IRQHandler
                 IMPORT  __use_two_region_memory
                 ENDIF
 
-                EXPORT  __initial_sp
                 IF      Heap_Size != 0                ; Heap is provided
                 EXPORT  __heap_base
                 EXPORT  __heap_limit
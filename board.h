@@ -0,0 +1,111 @@
+#ifndef BOARD_H
+#define BOARD_H
+
+/* Board description - one block per board revision, selected by define of Keil target
+(BOARD_REV1) or CMake variant. Port masks and the table of cathode pins for each digit
+(driver.c) are derived from it at compile time, static assertions below check the block.
+New revision is a new block only */
+
+#if defined(BOARD_REV1)
+	/* UART to RN42 Bluetooth module, 4028 decoder wired as 7442 on the original board */
+	#define BOARD_TX_PIN		0
+	#define BOARD_RX_PIN		6
+	#define BOARD_BT_RN42		1
+
+	/* anodes, bit 0 of tube masks (seconds) first */
+	#define BOARD_ANODE_0		13
+	#define BOARD_ANODE_1		17
+	#define BOARD_ANODE_2		15
+	#define BOARD_ANODE_3		1
+	#define BOARD_ANODE_4		7
+	#define BOARD_ANODE_5		14
+
+	/* pins of decoder inputs A (bit 0) to D (bit 3) */
+	#define BOARD_BCD_A			16
+	#define BOARD_BCD_B			11
+	#define BOARD_BCD_C			4
+	#define BOARD_BCD_D			10
+
+	/* decoder input lighting digit 0-9 */
+	#define BOARD_DIGIT_0		4
+	#define BOARD_DIGIT_1		2
+	#define BOARD_DIGIT_2		0
+	#define BOARD_DIGIT_3		7
+	#define BOARD_DIGIT_4		9
+	#define BOARD_DIGIT_5		5
+	#define BOARD_DIGIT_6		6
+	#define BOARD_DIGIT_7		8
+	#define BOARD_DIGIT_8		1
+	#define BOARD_DIGIT_9		3
+
+	#define BOARD_SW1			12
+	#define BOARD_SW2			5
+#else
+	/* original board, 7442 decoder */
+	#define BOARD_TX_PIN		6
+	#define BOARD_RX_PIN		0
+	#define BOARD_BT_RN42		0
+
+	#define BOARD_ANODE_0		13
+	#define BOARD_ANODE_1		17
+	#define BOARD_ANODE_2		15
+	#define BOARD_ANODE_3		1
+	#define BOARD_ANODE_4		7
+	#define BOARD_ANODE_5		14
+
+	#define BOARD_BCD_A			4
+	#define BOARD_BCD_B			16
+	#define BOARD_BCD_C			10
+	#define BOARD_BCD_D			11
+
+	#define BOARD_DIGIT_0		0
+	#define BOARD_DIGIT_1		1
+	#define BOARD_DIGIT_2		2
+	#define BOARD_DIGIT_3		3
+	#define BOARD_DIGIT_4		4
+	#define BOARD_DIGIT_5		5
+	#define BOARD_DIGIT_6		6
+	#define BOARD_DIGIT_7		7
+	#define BOARD_DIGIT_8		8
+	#define BOARD_DIGIT_9		9
+
+	#define BOARD_SW1			12
+	#define BOARD_SW2			5
+#endif
+
+/* ----------------------------- */
+
+#define BOARD_PINS 18 /* PIO0_0 - PIO0_17 of LPC812 */
+#define BOARD_TUBES 6
+
+#define PIN_BIT(pin) (1ul << (pin))
+
+#define ANODE_MASK (PIN_BIT(BOARD_ANODE_0) | PIN_BIT(BOARD_ANODE_1) | PIN_BIT(BOARD_ANODE_2) | \
+	PIN_BIT(BOARD_ANODE_3) | PIN_BIT(BOARD_ANODE_4) | PIN_BIT(BOARD_ANODE_5))
+#define BCD_MASK (PIN_BIT(BOARD_BCD_A) | PIN_BIT(BOARD_BCD_B) | PIN_BIT(BOARD_BCD_C) | PIN_BIT(BOARD_BCD_D))
+#define OUT_PORT_MASK (ANODE_MASK | BCD_MASK)
+#define IN_PORT_MASK (PIN_BIT(BOARD_SW1) | PIN_BIT(BOARD_SW2))
+
+/* port bits of decoder input code */
+#define BCD_PINS(code) ((((code) & 0x01) ? PIN_BIT(BOARD_BCD_A) : 0) | (((code) & 0x02) ? PIN_BIT(BOARD_BCD_B) : 0) | \
+	(((code) & 0x04) ? PIN_BIT(BOARD_BCD_C) : 0) | (((code) & 0x08) ? PIN_BIT(BOARD_BCD_D) : 0))
+
+/* Static assertion, compilation fails on array of negative size */
+#define BOARD_ASSERT(condition, name) typedef char board_assert_##name[(condition) ? 1 : -1]
+
+/* sum of distinct bits equals their OR */
+BOARD_ASSERT((PIN_BIT(BOARD_ANODE_0) + PIN_BIT(BOARD_ANODE_1) + PIN_BIT(BOARD_ANODE_2) + PIN_BIT(BOARD_ANODE_3) +
+	PIN_BIT(BOARD_ANODE_4) + PIN_BIT(BOARD_ANODE_5)) == ANODE_MASK, anodes_distinct);
+BOARD_ASSERT((PIN_BIT(BOARD_BCD_A) + PIN_BIT(BOARD_BCD_B) + PIN_BIT(BOARD_BCD_C) + PIN_BIT(BOARD_BCD_D)) == BCD_MASK, bcd_distinct);
+BOARD_ASSERT((PIN_BIT(BOARD_SW1) + PIN_BIT(BOARD_SW2)) == IN_PORT_MASK, switches_distinct);
+BOARD_ASSERT((PIN_BIT(BOARD_TX_PIN) + PIN_BIT(BOARD_RX_PIN)) == (PIN_BIT(BOARD_TX_PIN) | PIN_BIT(BOARD_RX_PIN)), uart_distinct);
+BOARD_ASSERT(((ANODE_MASK & BCD_MASK) == 0) && ((OUT_PORT_MASK & IN_PORT_MASK) == 0), groups_disjoint);
+BOARD_ASSERT(((OUT_PORT_MASK | IN_PORT_MASK) & (PIN_BIT(BOARD_TX_PIN) | PIN_BIT(BOARD_RX_PIN))) == 0, uart_pins_free);
+BOARD_ASSERT(((OUT_PORT_MASK | IN_PORT_MASK | PIN_BIT(BOARD_TX_PIN) | PIN_BIT(BOARD_RX_PIN)) >> BOARD_PINS) == 0, pins_exist);
+
+/* decoder inputs of digits are a permutation of 0-9 */
+BOARD_ASSERT((PIN_BIT(BOARD_DIGIT_0) + PIN_BIT(BOARD_DIGIT_1) + PIN_BIT(BOARD_DIGIT_2) + PIN_BIT(BOARD_DIGIT_3) +
+	PIN_BIT(BOARD_DIGIT_4) + PIN_BIT(BOARD_DIGIT_5) + PIN_BIT(BOARD_DIGIT_6) + PIN_BIT(BOARD_DIGIT_7) +
+	PIN_BIT(BOARD_DIGIT_8) + PIN_BIT(BOARD_DIGIT_9)) == 0x3FF, digits_permutation);
+
+#endif /* BOARD_H */
@@ -0,0 +1,360 @@
+/* Calendar regression test of time_inc_dec and days_in_month, host program (README.md).
+
+Steps the clock of driver.c second by second and day by day over years 2000-2199 in both
+directions and compares every state with a reference calendar counting seconds and days
+since 1.1.2000 (civil date from day number). Hours stepped with TIME_ONLY must not change
+the date, going below 1.1.FIRST_YEAR must stay there. Years of the second-by-second sweep
+are dealt to parallel processes, the day-by-day sweep runs before them.
+
+Usage: calendar_test [-j jobs] [-s first_year-last_year] [-d]
+	-j	processes of second-by-second sweep, default is the number of CPUs
+	-s	years of second-by-second sweep, default 2000-2199
+	-d	day-by-day sweep only
+
+Exits with 1 on the first mismatch, which is printed. Build with -DBCD_TIME to test
+packed-BCD time counters. */
+
+#include <stdio.h>
+#include <string.h>
+/* time_t of system headers collides with the one of driver.h */
+#define time_t host_time_t
+#include <sys/wait.h>
+#include <unistd.h>
+#undef time_t
+#include "driver.h"
+
+#define SWEEP_FIRST_YEAR 2000
+#define SWEEP_LAST_YEAR 2199
+#define SECONDS_PER_DAY 86400L
+#define MAX_JOBS 256
+
+/* reference state, seconds since 1.1.2000 00:00:00 */
+typedef struct ref {
+	long seconds;
+	long day; /* day of cached date, -1 = none */
+	int year;
+	int month;
+	int date;
+} ref_t;
+
+static long days_from_civil (int year, int month, int date);
+static void civil_from_days (long days, int* year, int* month, int* date);
+static void ref_set (ref_t* ref, long seconds);
+static void clock_set (time_t* time, const ref_t* ref);
+static int check (const time_t* time, ref_t* ref, const char* step);
+static int sweep_days (void);
+static int sweep_seconds (int first_year, int last_year);
+static int sweep_parallel (int first_year, int last_year, int jobs);
+
+
+int main (int argc, char** argv)
+{
+	int jobs;
+	int first_year = SWEEP_FIRST_YEAR;
+	int last_year = SWEEP_LAST_YEAR;
+	int days_only = 0;
+	int arg;
+
+	jobs = (int)sysconf(_SC_NPROCESSORS_ONLN);
+
+	for (arg = 1; arg < argc; arg++)
+	{
+		if ((strcmp(argv[arg], "-j") == 0) && (arg + 1 < argc))
+		{
+			sscanf(argv[++arg], "%d", &jobs);
+		}
+		else if ((strcmp(argv[arg], "-s") == 0) && (arg + 1 < argc))
+		{
+			if (sscanf(argv[++arg], "%d-%d", &first_year, &last_year) != 2)
+			{
+				last_year = first_year;
+			}
+		}
+		else if (strcmp(argv[arg], "-d") == 0)
+		{
+			days_only = 1;
+		}
+		else
+		{
+			fprintf(stderr, "usage: %s [-j jobs] [-s first_year-last_year] [-d]\n", argv[0]);
+			return 2;
+		}
+	}
+
+	if ((first_year < SWEEP_FIRST_YEAR) || (last_year > SWEEP_LAST_YEAR) || (first_year > last_year))
+	{
+		fprintf(stderr, "years must be within %d-%d\n", SWEEP_FIRST_YEAR, SWEEP_LAST_YEAR);
+		return 2;
+	}
+	if (jobs < 1)
+	{
+		jobs = 1;
+	}
+	if (jobs > MAX_JOBS)
+	{
+		jobs = MAX_JOBS;
+	}
+
+	if (sweep_days())
+	{
+		return 1;
+	}
+	printf("day by day %d-%d: ok\n", SWEEP_FIRST_YEAR, SWEEP_LAST_YEAR);
+
+	if (!days_only)
+	{
+		if (sweep_parallel(first_year, last_year, jobs))
+		{
+			return 1;
+		}
+		printf("second by second %d-%d: ok\n", first_year, last_year);
+	}
+
+	return 0;
+}
+
+/* Days since 1.3.0000 of proleptic Gregorian calendar shifted to 1.1.2000 = 0 */
+static long days_from_civil (int year, int month, int date)
+{
+	long era;
+	long year_of_era;
+	long day_of_year;
+	long day_of_era;
+
+	year -= (month <= 2);
+	era = year / 400;
+	year_of_era = year - era * 400;
+	day_of_year = (153 * (month + ((month > 2) ? -3 : 9)) + 2) / 5 + date - 1;
+	day_of_era = year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+
+	return era * 146097 + day_of_era - 730425; /* 730425 = 1.1.2000 */
+}
+
+static void civil_from_days (long days, int* year, int* month, int* date)
+{
+	long era;
+	long day_of_era;
+	long year_of_era;
+	long day_of_year;
+	long month_index;
+
+	days += 730425;
+	era = days / 146097;
+	day_of_era = days - era * 146097;
+	year_of_era = (day_of_era - day_of_era / 1460 + day_of_era / 36524 - day_of_era / 146096) / 365;
+	day_of_year = day_of_era - (365 * year_of_era + year_of_era / 4 - year_of_era / 100);
+	month_index = (5 * day_of_year + 2) / 153;
+
+	*date = (int)(day_of_year - (153 * month_index + 2) / 5 + 1);
+	*month = (int)(month_index + ((month_index < 10) ? 3 : -9));
+	*year = (int)(year_of_era + era * 400 + (*month <= 2));
+}
+
+static void ref_set (ref_t* ref, long seconds)
+{
+	ref->seconds = seconds;
+	ref->day = -1;
+}
+
+static void clock_set (time_t* time, const ref_t* ref)
+{
+	int year;
+	int month;
+	int date;
+	long second;
+
+	civil_from_days(ref->seconds / SECONDS_PER_DAY, &year, &month, &date);
+	second = ref->seconds % SECONDS_PER_DAY;
+
+	memset(time, 0, sizeof(*time));
+	time->seconds = TIME_FROM_BIN(second % 60);
+	time->minutes = TIME_FROM_BIN((second / 60) % 60);
+	time->hours = TIME_FROM_BIN(second / 3600);
+	time->days = date;
+	time->months = month;
+	time->years = year;
+}
+
+/* 0 if clock and reference are the same, date of reference is computed once per day */
+static int check (const time_t* time, ref_t* ref, const char* step)
+{
+	long day;
+	long second;
+
+	day = ref->seconds / SECONDS_PER_DAY;
+	second = ref->seconds % SECONDS_PER_DAY;
+	if (day != ref->day)
+	{
+		ref->day = day;
+		civil_from_days(day, &ref->year, &ref->month, &ref->date);
+	}
+
+	if ((TIME_TO_BIN(time->seconds) == second % 60) && (TIME_TO_BIN(time->minutes) == (second / 60) % 60) &&
+		(TIME_TO_BIN(time->hours) == second / 3600) && (time->days == ref->date) &&
+		(time->months == ref->month) && (time->years == ref->year))
+	{
+		return 0;
+	}
+
+	printf("%s: clock %02d:%02d:%02d %d.%d.%d, expected %02ld:%02ld:%02ld %d.%d.%d\n", step,
+		TIME_TO_BIN(time->hours), TIME_TO_BIN(time->minutes), TIME_TO_BIN(time->seconds),
+		time->days, time->months, time->years,
+		second / 3600, (second / 60) % 60, second % 60, ref->date, ref->month, ref->year);
+
+	return 1;
+}
+
+/* Every day forward and back at a time of day which must not change, hours of each
+day with TIME_ONLY wrap without changing the date, underflow of FIRST_YEAR is clamped */
+static int sweep_days (void)
+{
+	time_t time;
+	ref_t ref;
+	long day;
+	long last_day;
+	long time_of_day = 12 * 3600L + 34 * 60 + 56;
+	int hour;
+
+	last_day = days_from_civil(SWEEP_LAST_YEAR, 12, 31);
+
+	ref_set(&ref, time_of_day);
+	clock_set(&time, &ref);
+	for (day = 0; day < last_day; day++)
+	{
+		for (hour = 0; hour < 24; hour++)
+		{
+			time_inc_dec(&time, +1, HOURS | TIME_ONLY);
+			ref.seconds = day * SECONDS_PER_DAY + (time_of_day + (hour + 1) * 3600L) % SECONDS_PER_DAY;
+			if (check(&time, &ref, "hour +1 TIME_ONLY"))
+			{
+				return 1;
+			}
+		}
+		for (hour = 0; hour < 24; hour++)
+		{
+			time_inc_dec(&time, -1, HOURS | TIME_ONLY);
+			ref.seconds = day * SECONDS_PER_DAY + (time_of_day + (23 - hour) * 3600L) % SECONDS_PER_DAY;
+			if (check(&time, &ref, "hour -1 TIME_ONLY"))
+			{
+				return 1;
+			}
+		}
+
+		time_inc_dec(&time, +1, DAYS);
+		ref.seconds = (day + 1) * SECONDS_PER_DAY + time_of_day;
+		if (check(&time, &ref, "day +1"))
+		{
+			return 1;
+		}
+	}
+
+	for (day = last_day; day > 0; day--)
+	{
+		time_inc_dec(&time, -1, DAYS);
+		ref.seconds = (day - 1) * SECONDS_PER_DAY + time_of_day;
+		if (check(&time, &ref, "day -1"))
+		{
+			return 1;
+		}
+	}
+
+	/* 1.1.FIRST_YEAR is the lowest date, the clock stops at midnight of it */
+	time_inc_dec(&time, -1, DAYS);
+	ref.seconds = 0;
+	if (check(&time, &ref, "day -1 below first year"))
+	{
+		return 1;
+	}
+	time_inc_dec(&time, -1, SECONDS);
+	if (check(&time, &ref, "second -1 below first year"))
+	{
+		return 1;
+	}
+
+	return 0;
+}
+
+/* Years first_year..last_year forward from 1.1. of the first one to 1.1. of the year after
+the last one, then back */
+static int sweep_seconds (int first_year, int last_year)
+{
+	time_t time;
+	ref_t ref;
+	long start;
+	long end;
+
+	start = days_from_civil(first_year, 1, 1) * SECONDS_PER_DAY;
+	end = days_from_civil(last_year + 1, 1, 1) * SECONDS_PER_DAY;
+
+	ref_set(&ref, start);
+	clock_set(&time, &ref);
+	while (ref.seconds < end)
+	{
+		time_inc_dec(&time, +1, SECONDS);
+		ref.seconds++;
+		if (check(&time, &ref, "second +1"))
+		{
+			return 1;
+		}
+	}
+
+	while (ref.seconds > start)
+	{
+		time_inc_dec(&time, -1, SECONDS);
+		ref.seconds--;
+		if (check(&time, &ref, "second -1"))
+		{
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+/* Years are dealt to processes in turn, 0 when all of them passed */
+static int sweep_parallel (int first_year, int last_year, int jobs)
+{
+	pid_t pids[MAX_JOBS];
+	int years = last_year - first_year + 1;
+	int job;
+	int year;
+	int status;
+	int failed = 0;
+
+	if (jobs > years)
+	{
+		jobs = years;
+	}
+
+	for (job = 0; job < jobs; job++)
+	{
+		fflush(stdout);
+		pids[job] = fork();
+		if (pids[job] < 0)
+		{
+			perror("fork");
+			return 1;
+		}
+		if (pids[job] == 0)
+		{
+			for (year = first_year + job; year <= last_year; year += jobs)
+			{
+				if (sweep_seconds(year, year))
+				{
+					_exit(1);
+				}
+			}
+			_exit(0);
+		}
+	}
+
+	for (job = 0; job < jobs; job++)
+	{
+		if ((waitpid(pids[job], &status, 0) < 0) || !WIFEXITED(status) || (WEXITSTATUS(status) != 0))
+		{
+			failed = 1;
+		}
+	}
+
+	return failed;
+}
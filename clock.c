@@ -0,0 +1,77 @@
+#include "clock.h"
+#include "trace.h"
+
+static clock_user_t users[CLOCK_USERS_MAX];
+static uint8_t users_num = 0;
+static uint8_t requests = 0; /* bit per clock_request_t */
+static uint8_t divider = CLOCK_ACTIVE_DIVIDER; /* after reset */
+
+static void clock_set (uint8_t new_divider);
+
+
+/* Users are registered and timers run, clock drops to idle rate till something requests it */
+void clock_init (void)
+{
+	requests = 0;
+	clock_set(CLOCK_IDLE_DIVIDER);
+}
+
+/* Function recomputing intervals of a user, FALSE if the table is full */
+bool clock_register (clock_user_t user)
+{
+	if (users_num >= CLOCK_USERS_MAX)
+	{
+		TRACE(TRACE_STATE, TR_CLOCK_LOST, users_num);
+		return FALSE;
+	}
+
+	users[users_num++] = user;
+
+	return TRUE;
+}
+
+/* Main loop only, full rate while any request is active */
+void clock_request (clock_request_t request, bool active)
+{
+	if (active)
+	{
+		requests |= 1 << request;
+	}
+	else
+	{
+		requests &= ~(1 << request);
+	}
+
+	clock_set((requests != 0) ? CLOCK_ACTIVE_DIVIDER : CLOCK_IDLE_DIVIDER);
+}
+
+uint8_t clock_divider (void)
+{
+	return divider;
+}
+
+/* Interrupts see either the old or the new rate with all intervals matching it */
+static void clock_set (uint8_t new_divider)
+{
+	uint32_t irq_state;
+	uint8_t user;
+
+	if (new_divider == divider)
+	{
+		return;
+	}
+
+	irq_state = hal_irq_save();
+
+	/* timestamps of following records count the new clock */
+	TRACE(TRACE_STATE, TR_CLOCK, new_divider);
+	hal_clock_set_divider(new_divider);
+	divider = new_divider;
+
+	for (user = 0; user < users_num; user++)
+	{
+		users[user]();
+	}
+
+	hal_irq_restore(irq_state);
+}
@@ -0,0 +1,36 @@
+#ifndef CLOCK_H
+#define CLOCK_H
+
+/* Clock manager - system clock is divided down while only the display runs and raised to the
+full crystal rate for UART traffic and set mode. The crystal stays the source in both modes,
+SysTick keeps time across changes and running timers are rescaled by hal_clock_set_divider.
+Users of intervals derived from hal_clock_rate register a function recomputing them, it is
+called with interrupts disabled right after each change */
+
+#include "hal.h"
+
+#define CLOCK_ACTIVE_DIVIDER 1
+#define CLOCK_IDLE_DIVIDER 2 /* 9.2 MHz, at 4.6 MHz display paths go over their budgets (profile.c) */
+/* registered users: timer service, watchdog deadlines, display and cycle budgets of PROFILE,
+a user added without raising it is not registered and traced as TR_CLOCK_LOST */
+#ifdef PROFILE
+	#define CLOCK_USERS_MAX 4
+#else
+	#define CLOCK_USERS_MAX 3
+#endif
+
+/* reasons for the full clock, bit of each is set and cleared by main loop only */
+typedef enum {
+	CLOCK_REQ_UART,		/* bytes received in last RX_TIMEOUT */
+	CLOCK_REQ_SET_MODE,	/* set mode and its entry */
+	CLOCK_REQ_NUM /* Do not change */
+} clock_request_t;
+
+typedef void (*clock_user_t)(void);
+
+void clock_init (void);
+bool clock_register (clock_user_t user);
+void clock_request (clock_request_t request, bool active);
+uint8_t clock_divider (void);
+
+#endif /* CLOCK_H */
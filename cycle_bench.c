@@ -0,0 +1,572 @@
+/* Cycle benchmark of hot paths, firmware side (README.md).
+
+Linked with the firmware instead of its main (target cycle_bench of GCC build) and run by cycle_sim
+on an emulated Cortex-M0+, nothing here runs on the board. cycle_sim calls bench_init once, then
+for each case of each path bench_prepare sets up the state of the case, writes the function and
+its arguments to bench_call and returns the budget of the path in cycles at the current clock
+rate (profile.c, 0 = none, always with PROFILE). Only the call of bench_call is counted.
+
+Paths are the measured ones of profile.h, MRT_IRQHandler and PendSV_Handler are entered directly
+with pending flags of MRT and queued work set up as their interrupt would see them. UART commands
+are received through the emulated USART0 (bytes written to RXDAT are received) and each command
+of uart.h is a path of its own. Firmware state is restored before each case. */
+
+#include "nixie.h"
+#include "uart.h"
+#include "transition.h"
+#include "timer.h"
+#include "clock.h"
+#include "work.h"
+#include "supervisor.h"
+#include "profile.h"
+#include "trace.h"
+#include <string.h>
+
+/* levels of work posted by interrupts (nixie.c) */
+#define LEVEL_DISPLAY 0
+#define LEVEL_INPUT 1
+#define LEVEL_HOUSEKEEPING (HAL_IRQ_PRIORITIES - 1)
+
+#define SET_MODE_BLINK 2 /* set_mode of nixie.c */
+#define SET_MODE_INC 3
+#define PRE_SET_MODE 1
+#define NOT_IN_SET_MODE 0
+#define ALL_TUBES 0x3F
+
+#define LATE_TICKS 0x40000000 /* check-in older than any deadline of supervisor.c */
+#define UART_MSG_SIZE 6
+
+typedef struct bench_call {
+	uint32_t function;
+	uint32_t args[4]; /* r0-r3 */
+} bench_call_t;
+
+typedef struct bench_path {
+	const char* name;
+	uint16_t first; /* case of prepare */
+	uint16_t cases;
+	profile_path_t budget;
+	void (*prepare) (uint16_t index);
+} bench_path_t;
+
+/* MRT interrupt, pending flags of timer roles and multiplexing slot of the anode it finds */
+typedef struct mrt_case {
+	uint8_t roles; /* bit per timer_role_t */
+	uint8_t blank_expired; /* TIMER_BLANK expiries since start of slot, 0 = SLOT_BLANK */
+	uint8_t fade_level;
+	bool blink;
+} mrt_case_t;
+
+/* PendSV, work queued by interrupts and the state it finds */
+typedef struct pendsv_case {
+	uint8_t set_mode;
+	date_time field;
+	uint8_t work; /* bit per work_type_t */
+	uint8_t channel; /* of WORK_PRESS and WORK_RELEASE */
+	effect_t effect; /* transition running, EFFECTS_NUM = none */
+	bool last_frame; /* of transition */
+} pendsv_case_t;
+
+typedef struct time_case {
+	uint8_t seconds;
+	uint8_t minutes;
+	uint8_t hours;
+	uint8_t days;
+	uint8_t months;
+	uint16_t years;
+} time_case_t;
+
+typedef struct uart_case {
+	const char* name;
+	uint8_t frame[UART_MSG_SIZE];
+} uart_case_t;
+
+#define ROLE(role) (1 << (role))
+
+static const mrt_case_t mrt_cases[] = {
+	{ROLE(TIMER_REFRESH), 0, FADE_STEPS, FALSE},	/* start of slot, blanking */
+	{ROLE(TIMER_REFRESH) | ROLE(TIMER_ROLL), 0, FADE_STEPS, FALSE},
+	{ROLE(TIMER_BLANK), 0, FADE_STEPS, FALSE},	/* cathode */
+	{ROLE(TIMER_BLANK), 0, FADE_STEPS / 2, FALSE},	/* cathode of old digit of crossfade */
+	{ROLE(TIMER_BLANK), 1, FADE_STEPS, FALSE},	/* anode on */
+	{ROLE(TIMER_BLANK), 1, FADE_STEPS / 2, FALSE},	/* anode on, rest of slot split by crossfade */
+	{ROLE(TIMER_BLANK), 2, FADE_STEPS / 2, FALSE},	/* new digit of crossfade */
+	{ROLE(TIMER_BLANK) | ROLE(TIMER_ROLL) | ROLE(TIMER_SETTING), 1, FADE_STEPS / 2, FALSE},
+	/* blank is never pending with refresh, the last one-shot of a slot ends 50 us before it */
+	{ROLE(TIMER_REFRESH) | ROLE(TIMER_ROLL) | ROLE(TIMER_SETTING), 0, FADE_STEPS / 2, FALSE},
+	{ROLE(TIMER_ROLL) | ROLE(TIMER_SETTING), 0, FADE_STEPS, FALSE},
+	/* set mode only, blink is cleared out of it */
+	{ROLE(TIMER_BLANK), 0, FADE_STEPS, TRUE},	/* blinking tube stays blank */
+	{ROLE(TIMER_REFRESH) | ROLE(TIMER_SETTING), 0, FADE_STEPS, TRUE}
+};
+#define MRT_BLINK_CASES 2
+#define MRT_ANODES 2 /* each case with the first and the last tube */
+
+#define WORK(type) (1 << (type))
+
+static const pendsv_case_t pendsv_cases[] = {
+	{NOT_IN_SET_MODE, MINUTES, 0, 0, EFFECTS_NUM, FALSE},	/* nothing queued */
+	{NOT_IN_SET_MODE, MINUTES, WORK(WORK_TICK), 0, EFFECTS_NUM, FALSE},
+	{NOT_IN_SET_MODE, MINUTES, WORK(WORK_FRAME), 0, EFFECTS_NUM, FALSE},
+	{NOT_IN_SET_MODE, MINUTES, WORK(WORK_FRAME), 0, EFFECT_CASCADE, FALSE},
+	{NOT_IN_SET_MODE, MINUTES, WORK(WORK_FRAME), 0, EFFECT_CROSSFADE, TRUE},
+	{NOT_IN_SET_MODE, MINUTES, WORK(WORK_TICK) | WORK(WORK_FRAME), 0, EFFECT_SLOT_MACHINE, TRUE},
+	{NOT_IN_SET_MODE, MINUTES, WORK(WORK_REPEAT), 0, EFFECTS_NUM, FALSE},	/* set mode entry */
+	{NOT_IN_SET_MODE, MINUTES, WORK(WORK_RELEASE), 3, EFFECTS_NUM, FALSE},	/* time/date */
+	{PRE_SET_MODE, MINUTES, WORK(WORK_TICK), 0, EFFECTS_NUM, FALSE},
+	{PRE_SET_MODE, MINUTES, WORK(WORK_RELEASE), 3, EFFECTS_NUM, FALSE},	/* set mode starts */
+	{SET_MODE_BLINK, MINUTES, WORK(WORK_TICK), 0, EFFECTS_NUM, FALSE},
+	{SET_MODE_BLINK, DAYS, WORK(WORK_TICK) | WORK(WORK_FRAME), 0, EFFECTS_NUM, FALSE},
+	{SET_MODE_BLINK, HOURS, WORK(WORK_PRESS), 1, EFFECTS_NUM, FALSE},
+	{SET_MODE_BLINK, DAYS, WORK(WORK_PRESS), 0, EFFECTS_NUM, FALSE},
+	{SET_MODE_BLINK, YEARS, WORK(WORK_PRESS), 3, EFFECTS_NUM, FALSE},	/* next field */
+	{SET_MODE_INC, MINUTES, WORK(WORK_REPEAT), 1, EFFECTS_NUM, FALSE},
+	{SET_MODE_INC, MONTHS, WORK(WORK_REPEAT) | WORK(WORK_RELEASE), 1, EFFECTS_NUM, FALSE}
+};
+
+/* times of second_tick, carries up to the end of year */
+static const time_case_t time_cases[] = {
+	{56, 34, 12, 15, 6, 2024},
+	{59, 34, 12, 15, 6, 2024},
+	{59, 59, 12, 15, 6, 2024},
+	{59, 59, 23, 15, 6, 2024},
+	{59, 59, 23, 30, 6, 2024},
+	{59, 59, 23, 28, 2, 2023},
+	{59, 59, 23, 28, 2, 2024},
+	{59, 59, 23, 29, 2, 2024},
+	{59, 59, 23, 28, 2, 2100},
+	{59, 59, 23, 31, 12, 2023},
+	{59, 59, 23, 31, 12, 2099}
+};
+
+/* frames of each command of uart.h, cases of a command are adjacent */
+static const uart_case_t uart_cases[] = {
+	{"uart_set_time", {START_FLAG, SET | UART_TIME, 23, 59, 59, 0}},
+	{"uart_set_time", {START_FLAG, SET | UART_TIME, 24, 0, 0, 0}},
+	{"uart_set_date", {START_FLAG, SET | UART_DATE, 29, 2, 2024 >> 8, 2024 & 0xFF}},
+	{"uart_set_date", {START_FLAG, SET | UART_DATE, 29, 2, 2023 >> 8, 2023 & 0xFF}},
+	{"uart_set_intervals", {START_FLAG, SET | SHOW_INTERVALS, 60, 5, 5, 0}},
+	{"uart_set_transitions", {START_FLAG, SET | TRANSITIONS, TO_TIME, EFFECT_CASCADE, 0, 0}},
+	{"uart_set_transitions", {START_FLAG, SET | TRANSITIONS, VALUE_CHANGE, EFFECT_CROSSFADE, 12, 0}},
+	{"uart_set_transitions", {START_FLAG, SET | TRANSITIONS, TRANSITIONS_NUM, EFFECT_NONE, 0, 0}},
+	{"uart_set_display_mode", {START_FLAG, SET | DISPLAY_MODE, DISPLAY_OPTIONS, 0, 0, 0}},
+	{"uart_set_display_mode", {START_FLAG, SET | DISPLAY_MODE, 0xFF, 0, 0, 0}},
+	{"uart_ping", {START_FLAG, PING, 0, 0, 0, 0}},
+	{"uart_get_time", {START_FLAG, GET | UART_TIME, 0, 0, 0, 0}},
+	{"uart_get_date", {START_FLAG, GET | UART_DATE, 0, 0, 0, 0}},
+	{"uart_get_intervals", {START_FLAG, GET | SHOW_INTERVALS, 0, 0, 0, 0}},
+	{"uart_get_transitions", {START_FLAG, GET | TRANSITIONS, 0, 0, 0, 0}},
+	{"uart_get_display_mode", {START_FLAG, GET | DISPLAY_MODE, 0, 0, 0, 0}},
+	{"uart_disp", {START_FLAG, DISP, 12, 34, 56, 0}},
+	{"uart_disp", {START_FLAG, DISP, 100, 0, 0, 0}},
+	{"uart_disp_stream", {START_FLAG, DISP | STREAM, 0x12, 0x34, 0x56, 0x00}},
+	{"uart_disp_stream", {START_FLAG, DISP | STREAM, 0x12, 0x34, 0x56, 0x3F}},
+	{"uart_disp_stream", {START_FLAG, DISP | STREAM, 0x1A, 0x34, 0x56, 0x00}},
+	{"uart_get_stream", {START_FLAG, GET | STREAM, 0, 0, 0, 0}},
+	{"uart_toggle", {START_FLAG, TOGGLE, 0, 0, 0, 0}},
+#ifdef PROFILE
+	{"uart_set_cycles", {START_FLAG, SET | CYCLES, 0, 0, 0, 0}},
+	{"uart_get_cycles", {START_FLAG, GET | CYCLES, PROF_MRT_DISPLAY, 0, 0, 0}},
+	{"uart_get_jitter", {START_FLAG, GET | JITTER, PROF_ANODE_ON_TIME, 0, 0, 0}},
+#endif
+	{"uart_set_trace_log", {START_FLAG, SET | TRACE_LOG, TRACE_STATE, 0, 0, 0}},
+	{"uart_get_trace_log", {START_FLAG, GET | TRACE_LOG, 0, 0, 0, 0}},
+	{"uart_get_trace_log", {START_FLAG, GET | TRACE_LOG, 0xFF, 0, 0, 0}},
+	{"uart_get_stack_usage", {START_FLAG, GET | STACK_USAGE, 0, 0, 0, 0}},
+	{"uart_set_watchdog", {START_FLAG, SET | WATCHDOG, 0, 0, 0, 0}},
+	{"uart_get_watchdog", {START_FLAG, GET | WATCHDOG, 0, 0, 0, 0}},
+	{"uart_set_fault", {START_FLAG, SET | FAULT, 0, 0, 0, 0}},
+	{"uart_get_fault", {START_FLAG, GET | FAULT, 0, 0, 0, 0}},
+	{"uart_get_fault", {START_FLAG, GET | FAULT, 0xFF, 0, 0, 0}},
+	{"uart_get_timers", {START_FLAG, GET | TIMERS, TIMER_BLANK, 0, 0, 0}},
+	{"uart_unknown", {START_FLAG, GET | 0x0F, 0, 0, 0, 0}},
+	{"uart_bad_frame", {0x00, GET | UART_TIME, 0, 0, 0, 0}}
+};
+
+static const display_t digits_from = {0x59, 0x59, 0x23, 0};
+static const display_t digits_to = {0x00, 0x00, 0x00, 0};
+static const display_t fade_from = {0x21, 0x43, 0x65, 0};
+
+static void mrt_display_prepare (uint16_t index);
+static void mrt_set_mode_prepare (uint16_t index);
+static void systick_prepare (uint16_t index);
+static void pendsv_prepare (uint16_t index);
+static void transition_tick_prepare (uint16_t index);
+static void to_BCD_prepare (uint16_t index);
+static void time_inc_dec_prepare (uint16_t index);
+static void uart_prepare (uint16_t index);
+
+#define MRT_CASES (sizeof(mrt_cases) / sizeof(mrt_cases[0]))
+#define PENDSV_CASES (sizeof(pendsv_cases) / sizeof(pendsv_cases[0]))
+#define TIME_CASES (sizeof(time_cases) / sizeof(time_cases[0]))
+#define UART_CASES (sizeof(uart_cases) / sizeof(uart_cases[0]))
+#define SYSTICK_CASES 6
+#define TRANSITION_CASES (1 + 2 * EFFECTS_NUM) /* not running, first and last frame of each effect */
+#define BENCH_PATHS (sizeof(bench_paths) / sizeof(bench_paths[0]))
+
+volatile bench_call_t bench_call;
+
+/* toolchain and build options, baselines of cycle_baseline.txt are kept per image */
+const char bench_config[] = "LPC812"
+#ifdef BOARD_REV1
+	" BOARD_REV1"
+#endif
+#ifdef BCD_TIME
+	" BCD_TIME"
+#endif
+#ifdef RAM_ISR
+	" RAM_ISR"
+#endif
+#ifdef PROFILE
+	" PROFILE"
+#endif
+	;
+
+static const bench_path_t bench_paths[] = {
+	{"mrt_display", 0, (MRT_CASES - MRT_BLINK_CASES) * MRT_ANODES, PROF_MRT_DISPLAY, mrt_display_prepare},
+	{"mrt_set_mode", 0, MRT_CASES * MRT_ANODES, PROF_MRT_SET_MODE, mrt_set_mode_prepare},
+	{"systick", 0, SYSTICK_CASES, PROF_SYSTICK, systick_prepare},
+	{"pendsv", 0, PENDSV_CASES, PROF_PENDSV, pendsv_prepare},
+	{"transition_tick", 0, TRANSITION_CASES, PROF_TRANSITION_TICK, transition_tick_prepare},
+	{"to_BCD", 0, 100, PROF_TO_BCD, to_BCD_prepare},
+	{"time_inc_dec", 0, TIME_CASES, PROF_TIME_INC_DEC, time_inc_dec_prepare}
+};
+static bench_path_t uart_paths[UART_CASES]; /* a path per command, they follow bench_paths */
+static uint8_t uart_paths_num = 0;
+
+static time_t time_start;
+static display_t user_data_start;
+static uint8_t armed_start;
+static display_frame_t frame; /* of transition_tick */
+
+uint8_t bench_init (void);
+const char* bench_name (uint8_t path);
+uint16_t bench_cases (uint8_t path);
+uint32_t bench_prepare (uint8_t path, uint16_t index);
+
+static const bench_path_t* path_of (uint8_t path);
+static void bench_restore (void);
+static void mrt_expire (uint8_t roles);
+static void mrt_prepare (uint16_t index);
+static void transition_prepare (effect_t effect, bool last_frame);
+static void set_mode_enter (uint8_t mode, date_time field);
+
+
+/* Firmware initialized as by main, returns number of paths */
+uint8_t bench_init (void)
+{
+	bench_path_t* path = NULL;
+	uint16_t index;
+
+	nixie_init();
+
+	time_start = my_time;
+	user_data_start = user_data;
+	armed_start = supervisor_armed;
+
+	/* cases of a command follow each other */
+	for (index = 0; index < UART_CASES; index++)
+	{
+		if ((path != NULL) && (strcmp(uart_cases[index].name, path->name) == 0))
+		{
+			path->cases++;
+			continue;
+		}
+
+		path = &uart_paths[uart_paths_num++];
+		path->name = uart_cases[index].name;
+		path->first = index;
+		path->cases = 1;
+		path->budget = PROF_UART_CMD;
+		path->prepare = uart_prepare;
+	}
+
+	return BENCH_PATHS + uart_paths_num;
+}
+
+const char* bench_name (uint8_t path)
+{
+	return path_of(path)->name;
+}
+
+uint16_t bench_cases (uint8_t path)
+{
+	return path_of(path)->cases;
+}
+
+/* State of case set up and its call in bench_call, returns budget in cycles (0 = none) */
+uint32_t bench_prepare (uint8_t path, uint16_t index)
+{
+	const bench_path_t* bench_path = path_of(path);
+
+	bench_restore();
+	bench_path->prepare(bench_path->first + index);
+
+#ifdef PROFILE
+	/* cycles counted here include profile_start/end and jitter hooks, the board subtracts them
+	(profile_end), only baselines of a PROFILE image are checked */
+	return 0;
+#else
+	return profile_budget_us(bench_path->budget) * (hal_clock_rate() / 1000000);
+#endif
+}
+
+static const bench_path_t* path_of (uint8_t path)
+{
+	return (path < BENCH_PATHS) ? &bench_paths[path] : &uart_paths[path - BENCH_PATHS];
+}
+
+/* Clock, display and set mode as after nixie_init, idle clock, nothing queued */
+static void bench_restore (void)
+{
+	mrt_expire(0);
+
+	my_time = time_start;
+	user_data = user_data_start;
+	set_mode = NOT_IN_SET_MODE;
+	blink = FALSE;
+	blink_mask = ALL_TUBES;
+	leave_set_mode = 0;
+	set_field = MINUTES;
+	display_dirty = FALSE;
+	supervisor_armed = armed_start;
+
+	clock_request(CLOCK_REQ_UART, FALSE);
+	clock_request(CLOCK_REQ_SET_MODE, FALSE);
+	display_set_options(0);
+	transition_cancel();
+	work_init();
+}
+
+/* Pending flags of MRT as set by expiry of timer roles, MRT_IRQHandler clears them */
+static void mrt_expire (uint8_t roles)
+{
+	uint32_t flags = 0;
+	uint8_t role;
+
+	for (role = 0; role < TIMER_ROLES_NUM; role++)
+	{
+		if (roles & ROLE(role))
+		{
+			flags |= timer_slots[role].flag;
+		}
+	}
+
+	LPC_MRT->IRQ_FLAG = flags;
+}
+
+static void mrt_display_prepare (uint16_t index)
+{
+	mrt_prepare(index);
+}
+
+/* Set mode runs at full clock, blinking tubes are those of the field being set */
+static void mrt_set_mode_prepare (uint16_t index)
+{
+	set_mode_enter(SET_MODE_BLINK, MINUTES);
+	mrt_prepare(index);
+}
+
+/* Shown frame with all slots on one tube, the slot is brought to its phase by earlier
+expiries of TIMER_BLANK */
+static void mrt_prepare (uint16_t index)
+{
+	const mrt_case_t* mrt_case = &mrt_cases[index / MRT_ANODES];
+	display_frame_t shown;
+	uint8_t anode;
+	uint8_t expired;
+
+	anode = ((index % MRT_ANODES) == 0) ? 0 : (BOARD_TUBES - 1);
+
+	shown.digits = digits_from;
+	shown.fade_from = fade_from;
+	shown.fade_level = mrt_case->fade_level;
+	for (expired = 0; expired < BOARD_TUBES; expired++)
+	{
+		shown.next_tube[expired] = anode;
+	}
+	display_frames[display_seq & 0x01] = shown;
+
+	blink = FALSE;
+	mrt_expire(ROLE(TIMER_REFRESH));
+	MRT_IRQHandler();
+	for (expired = 0; expired < mrt_case->blank_expired; expired++)
+	{
+		mrt_expire(ROLE(TIMER_BLANK));
+		MRT_IRQHandler();
+	}
+
+	if (set_mode != NOT_IN_SET_MODE)
+	{
+		blink_mask = 1 << anode;
+		blink = mrt_case->blink;
+	}
+
+	work_init();
+	mrt_expire(mrt_case->roles);
+	bench_call.function = (uint32_t)MRT_IRQHandler;
+}
+
+/* All armed tasks checked in on time, one or all late, queue of SysTick full */
+static void systick_prepare (uint16_t index)
+{
+	static const uint8_t armed[SYSTICK_CASES] = {0x00, 0x07, 0x0F, 0x0F, 0x0F, 0x0F};
+	static const uint8_t late[SYSTICK_CASES] = {0x00, 0x00, 0x00, 1 << SUP_UART_PARSER, 0x0F, 0x00};
+	uint8_t task;
+
+	supervisor_armed = armed[index];
+	for (task = 0; task < SUP_TASKS_NUM; task++)
+	{
+		supervisor_check_in_time[task] = hal_timestamp() - ((late[index] & (1 << task)) ? LATE_TICKS : 0);
+	}
+
+	if (index == SYSTICK_CASES - 1)
+	{
+		while (work_post(LEVEL_HOUSEKEEPING, WORK_TICK, 0))
+		{
+		}
+	}
+
+	bench_call.function = (uint32_t)SysTick_Handler;
+}
+
+static void pendsv_prepare (uint16_t index)
+{
+	const pendsv_case_t* pendsv_case = &pendsv_cases[index];
+	uint8_t work = pendsv_case->work;
+
+	my_time.seconds = TIME_FROM_BIN(59);
+	my_time.minutes = TIME_FROM_BIN(59);
+	my_time.hours = TIME_FROM_BIN(23);
+	my_time.change_display_timeout = my_time.show_time; /* date is shown next */
+
+	if (pendsv_case->effect != EFFECTS_NUM)
+	{
+		transition_prepare(pendsv_case->effect, pendsv_case->last_frame);
+	}
+
+	if (pendsv_case->set_mode == SET_MODE_INC)
+	{
+		/* button held, increment of set_button sets the direction of repeated ones */
+		set_mode_enter(SET_MODE_BLINK, pendsv_case->field);
+		work_post(LEVEL_INPUT, WORK_PRESS, pendsv_case->channel);
+		PendSV_Handler();
+	}
+	else if (pendsv_case->set_mode != NOT_IN_SET_MODE)
+	{
+		set_mode_enter(pendsv_case->set_mode, pendsv_case->field);
+		display_dirty = TRUE;
+		leave_set_mode = 0xF0; /* past LEAVE_SET_MODE_IN of nixie.c, next tick leaves */
+	}
+
+	if (work & WORK(WORK_TICK))
+	{
+		work_post(LEVEL_HOUSEKEEPING, WORK_TICK, 0);
+	}
+	if (work & WORK(WORK_FRAME))
+	{
+		work_post(LEVEL_DISPLAY, WORK_FRAME, 0);
+	}
+	if (work & WORK(WORK_REPEAT))
+	{
+		work_post(LEVEL_DISPLAY, WORK_REPEAT, 0);
+	}
+	if (work & WORK(WORK_PRESS))
+	{
+		work_post(LEVEL_INPUT, WORK_PRESS, pendsv_case->channel);
+	}
+	if (work & WORK(WORK_RELEASE))
+	{
+		work_post(LEVEL_INPUT, WORK_RELEASE, pendsv_case->channel);
+	}
+
+	bench_call.function = (uint32_t)PendSV_Handler;
+}
+
+/* Running transition from digits_from to digits_to, at its first or last frame */
+static void transition_prepare (effect_t effect, bool last_frame)
+{
+	uint8_t frames = 0;
+
+	if (last_frame)
+	{
+		transition_start(digits_from, digits_to, effect);
+		while (transition_tick(&my_time, &frame))
+		{
+			frames++;
+		}
+
+		transition_start(digits_from, digits_to, effect);
+		while (frames-- > 1)
+		{
+			transition_tick(&my_time, &frame);
+		}
+	}
+	else
+	{
+		transition_start(digits_from, digits_to, effect);
+	}
+}
+
+/* Set mode as entered by buttons at full clock */
+static void set_mode_enter (uint8_t mode, date_time field)
+{
+	clock_request(CLOCK_REQ_SET_MODE, TRUE);
+	set_mode = mode;
+	select_set_field(field);
+}
+
+static void transition_tick_prepare (uint16_t index)
+{
+	if (index > 0)
+	{
+		transition_prepare((effect_t)((index - 1) / 2), ((index - 1) % 2) != 0);
+	}
+
+	bench_call.function = (uint32_t)transition_tick;
+	bench_call.args[0] = (uint32_t)&my_time;
+	bench_call.args[1] = (uint32_t)&frame;
+}
+
+static void to_BCD_prepare (uint16_t index)
+{
+	bench_call.function = (uint32_t)to_BCD;
+	bench_call.args[0] = index;
+}
+
+/* One second as counted by second_tick */
+static void time_inc_dec_prepare (uint16_t index)
+{
+	const time_case_t* time_case = &time_cases[index];
+
+	my_time.seconds = TIME_FROM_BIN(time_case->seconds);
+	my_time.minutes = TIME_FROM_BIN(time_case->minutes);
+	my_time.hours = TIME_FROM_BIN(time_case->hours);
+	my_time.days = time_case->days;
+	my_time.months = time_case->months;
+	my_time.years = time_case->years;
+
+	bench_call.function = (uint32_t)time_inc_dec;
+	bench_call.args[0] = (uint32_t)&my_time;
+	bench_call.args[1] = +1;
+	bench_call.args[2] = SECONDS;
+}
+
+/* Message received into the ring by UART0_IRQHandler, main loop raised the clock for it */
+static void uart_prepare (uint16_t index)
+{
+	uint8_t byte;
+
+	clock_request(CLOCK_REQ_UART, TRUE);
+	UART_init();
+
+	for (byte = 0; byte < UART_MSG_SIZE; byte++)
+	{
+		*(volatile uint32_t*)&LPC_USART0->RXDATA = uart_cases[index].frame[byte];
+	}
+	UART0_IRQHandler();
+
+	bench_call.function = (uint32_t)UART_commands_exec;
+	bench_call.args[0] = (uint32_t)&my_time;
+	bench_call.args[1] = (uint32_t)&user_data;
+}
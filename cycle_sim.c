@@ -0,0 +1,1498 @@
+/* Cycle benchmark of hot paths on emulated Cortex-M0+, host program (README.md).
+
+Runs cycle_bench.elf (firmware with cycle_bench.c, target cycle_bench of GCC build) on an
+instruction set simulator of ARMv6-M. bench_init runs once, then each case of each path is set up
+by bench_prepare, not counted, and the function of the path is called with its arguments and
+counted from its first instruction to its return. Worst case and sum of all cases of each path
+are compared with the baselines of the same toolchain and build options (section of baseline file,
+cycle_baseline.txt), worst case also with the budget of the path (profile.c) at the clock rate
+the case runs at. Counts are exact for the model below, any cycle over a baseline fails.
+
+Timing of Cortex-M0+: 1 cycle for ALU instructions, MUL (single-cycle multiplier of LPC8xx),
+CPS and not taken conditional branch, 2 for loads and stores except single-cycle I/O port
+(GPIO and pin interrupts, 1 cycle), taken branch, BX and BLX, 3 for BL, MRS, MSR and barriers,
+1+N for PUSH, POP, LDM and STM of N registers, 3+N for POP with PC. Flash and buses have no wait
+states (LPC812 runs flash without them up to 20 MHz, at 30 MHz 1 wait state adds to fetches and
+literal loads), exception entry and return (15 cycles) are not counted, interrupts are never taken.
+
+Peripherals are memory without side effects except: SysTick counts down at half of cycle rate when
+enabled, SCT counter is the cycle count, main clock is the crystal with system clock divider 1 as
+set up on the board (budgets are checked at the rate derived from OscRateIn), USART0 receives bytes
+written by the bench to RXDAT and sends one byte, TXRDY stays clear for the rest of the case.
+
+Usage: cycle_sim [-v] [-u] [-b baseline] bench.elf
+	-b	baseline file, section of toolchain and build options of the image is checked
+	-u	measured cycles become the baseline of the image (its section replaced or added)
+	-v	cycles of each case
+
+Exit status is 1 when a path is over its budget or baseline, 2 on error of image or simulation */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#define MAX_PATHS 64
+#define MAX_NAME 32
+#define MAX_KEY 256
+#define MAX_LINE 512
+#define MAX_BASELINE_LINES 1024
+#define RX_FIFO_SIZE 64
+
+#define RETURN_ADDRESS 0xFFFFFFFFul /* LR of called function, BX to it ends the call */
+#define CALL_MAX_CYCLES 20000000ul /* bench_init and bench_prepare included */
+#define STACK_PAINT 0xC5C5C5C5ul /* HAL_STACK_PAINT of hal.h, done by Reset_Handler on target */
+
+#define SP 13
+#define LR 14
+#define PC 15
+
+/* Registers with side effects */
+#define SYSTICK_CTRL 0xE000E010ul
+#define SYSTICK_LOAD 0xE000E014ul
+#define SYSTICK_VAL 0xE000E018ul
+#define SCT_COUNT 0x50004040ul
+#define SYSCON_SYSPLLCLKSEL 0x40048040ul
+#define SYSCON_MAINCLKSEL 0x40048070ul
+#define SYSCON_SYSAHBCLKDIV 0x40048078ul
+#define USART0_STAT 0x40064008ul
+#define USART0_RXDAT 0x40064014ul
+#define USART0_TXDAT 0x4006401Cul
+#define USART_STAT_RXRDY 0x01
+#define USART_STAT_RXIDLE 0x02
+#define USART_STAT_TXRDY 0x04
+#define USART_STAT_TXIDLE 0x08
+
+typedef struct region {
+	uint32_t base;
+	uint32_t size;
+	int fast_io; /* single-cycle I/O port */
+	uint8_t* data;
+} region_t;
+
+/* Flash and RAM of the largest LPC8xx part, the image is linked for LPC812 */
+static region_t regions[] = {
+	{0x00000000, 0x10000, 0, NULL},	/* flash */
+	{0x10000000, 0x2000, 0, NULL},	/* RAM */
+	{0x14000000, 0x1000, 0, NULL},	/* MTB registers */
+	{0x40000000, 0x80000, 0, NULL},	/* APB peripherals */
+	{0x50000000, 0x8000, 0, NULL},	/* AHB peripherals (CRC, SCT) */
+	{0xA0000000, 0x8000, 1, NULL},	/* GPIO and pin interrupts */
+	{0xE000E000, 0x1000, 0, NULL}	/* SysTick, NVIC, SCB */
+};
+#define REGIONS_NUM (sizeof(regions) / sizeof(regions[0]))
+
+typedef struct cpu {
+	uint32_t r[16];
+	int n, z, c, v;
+	uint32_t primask;
+	uint64_t cycles;
+} cpu_t;
+
+static cpu_t cpu;
+static uint32_t systick_val;
+static uint64_t systick_at; /* cycle of the last update of systick_val */
+static uint8_t rx_fifo[RX_FIFO_SIZE];
+static int rx_count;
+static int tx_busy;
+static char error[MAX_LINE];
+
+typedef struct path {
+	char name[MAX_NAME];
+	unsigned cases;
+	uint32_t min;
+	uint32_t max;
+	uint64_t total;
+	uint32_t budget; /* the smallest one of its cases, 0 = none */
+	unsigned over_budget; /* cases */
+	int baseline; /* found in baseline file */
+	uint32_t baseline_max;
+	uint64_t baseline_total;
+} path_t;
+
+static path_t paths[MAX_PATHS];
+static int paths_num;
+
+/* Symbols of the bench, cycle_bench.c */
+typedef struct image {
+	uint32_t stack_top;
+	uint32_t stack_limit;
+	uint32_t bench_init;
+	uint32_t bench_name;
+	uint32_t bench_cases;
+	uint32_t bench_prepare;
+	uint32_t bench_call;
+	uint32_t bench_config;
+	char key[MAX_KEY]; /* compiler and build options, section of baselines */
+} image_t;
+
+static image_t image;
+
+/* ---- memory ---- */
+
+static region_t* region_of (uint32_t address, uint32_t size)
+{
+	unsigned i;
+
+	for (i = 0; i < REGIONS_NUM; i++)
+	{
+		if ((address >= regions[i].base) && (address - regions[i].base + size <= regions[i].size))
+		{
+			return &regions[i];
+		}
+	}
+	return NULL;
+}
+
+/* SysTick advanced to the current cycle, it wraps from 0 to reload value */
+static void systick_update (void)
+{
+	uint64_t ticks;
+	uint32_t load;
+	region_t* scs = region_of(SYSTICK_LOAD, 4);
+
+	ticks = (cpu.cycles - systick_at) / 2;
+	systick_at += ticks * 2;
+	if (!(scs->data[SYSTICK_CTRL - scs->base] & 0x01) || (ticks == 0))
+	{
+		return;
+	}
+
+	memcpy(&load, &scs->data[SYSTICK_LOAD - scs->base], 4);
+	load &= 0xFFFFFF;
+	if (ticks <= systick_val)
+	{
+		systick_val -= (uint32_t)ticks;
+	}
+	else
+	{
+		ticks -= systick_val + 1;
+		systick_val = load - (uint32_t)(ticks % ((uint64_t)load + 1));
+	}
+}
+
+static uint32_t usart_status (void)
+{
+	uint32_t status = USART_STAT_RXIDLE;
+
+	if (rx_count > 0)
+	{
+		status |= USART_STAT_RXRDY;
+	}
+	if (!tx_busy)
+	{
+		status |= USART_STAT_TXRDY | USART_STAT_TXIDLE;
+	}
+	return status;
+}
+
+static int mem_read (uint32_t address, uint32_t size, uint32_t* value)
+{
+	region_t* region;
+	uint32_t offset;
+
+	if (address & (size - 1))
+	{
+		snprintf(error, sizeof(error), "unaligned read of %u bytes at 0x%08X", size, address);
+		return 0;
+	}
+
+	if (size == 4)
+	{
+		switch (address)
+		{
+			case SYSTICK_VAL:
+				systick_update();
+				*value = systick_val;
+				return 1;
+			case SCT_COUNT:
+				*value = (uint32_t)cpu.cycles;
+				return 1;
+			case USART0_STAT:
+				*value = usart_status();
+				return 1;
+			case USART0_RXDAT:
+				*value = 0;
+				if (rx_count > 0)
+				{
+					*value = rx_fifo[0];
+					memmove(rx_fifo, rx_fifo + 1, --rx_count);
+				}
+				return 1;
+		}
+	}
+
+	region = region_of(address, size);
+	if (region == NULL)
+	{
+		snprintf(error, sizeof(error), "read of %u bytes at 0x%08X outside of memory", size, address);
+		return 0;
+	}
+
+	offset = address - region->base;
+	*value = region->data[offset];
+	if (size >= 2)
+	{
+		*value |= (uint32_t)region->data[offset + 1] << 8;
+	}
+	if (size == 4)
+	{
+		*value |= ((uint32_t)region->data[offset + 2] << 16) | ((uint32_t)region->data[offset + 3] << 24);
+	}
+	return 1;
+}
+
+static int mem_write (uint32_t address, uint32_t size, uint32_t value)
+{
+	region_t* region;
+	uint32_t offset;
+
+	if (address & (size - 1))
+	{
+		snprintf(error, sizeof(error), "unaligned write of %u bytes at 0x%08X", size, address);
+		return 0;
+	}
+
+	if (size == 4)
+	{
+		switch (address)
+		{
+			case SYSTICK_VAL:
+				/* any write clears the counter, reload comes with the next tick */
+				systick_update();
+				systick_val = 0;
+				return 1;
+			case SYSTICK_CTRL:
+			case SYSTICK_LOAD:
+				systick_update();
+				break;
+			case USART0_RXDAT:
+				if (rx_count < RX_FIFO_SIZE)
+				{
+					rx_fifo[rx_count++] = (uint8_t)value;
+				}
+				return 1;
+			case USART0_TXDAT:
+				tx_busy = 1;
+				return 1;
+		}
+	}
+
+	region = region_of(address, size);
+	if (region == NULL)
+	{
+		snprintf(error, sizeof(error), "write of %u bytes at 0x%08X outside of memory", size, address);
+		return 0;
+	}
+	if (region == &regions[0])
+	{
+		snprintf(error, sizeof(error), "write of %u bytes to flash at 0x%08X", size, address);
+		return 0;
+	}
+
+	offset = address - region->base;
+	region->data[offset] = (uint8_t)value;
+	if (size >= 2)
+	{
+		region->data[offset + 1] = (uint8_t)(value >> 8);
+	}
+	if (size == 4)
+	{
+		region->data[offset + 2] = (uint8_t)(value >> 16);
+		region->data[offset + 3] = (uint8_t)(value >> 24);
+	}
+	return 1;
+}
+
+/* cycles of a single load or store */
+static uint32_t access_cycles (uint32_t address)
+{
+	region_t* region = region_of(address, 1);
+
+	return ((region != NULL) && region->fast_io) ? 1 : 2;
+}
+
+/* ---- ARMv6-M instructions ---- */
+
+static void set_nz (uint32_t result)
+{
+	cpu.n = (result >> 31) != 0;
+	cpu.z = (result == 0);
+}
+
+static uint32_t add_with_carry (uint32_t x, uint32_t y, uint32_t carry, int set_flags)
+{
+	uint64_t sum = (uint64_t)x + y + carry;
+	uint32_t result = (uint32_t)sum;
+
+	if (set_flags)
+	{
+		set_nz(result);
+		cpu.c = (sum >> 32) != 0;
+		cpu.v = (((x ^ result) & (y ^ result)) >> 31) != 0;
+	}
+	return result;
+}
+
+static int condition (uint32_t cond)
+{
+	switch (cond)
+	{
+		case 0x0: return cpu.z;
+		case 0x1: return !cpu.z;
+		case 0x2: return cpu.c;
+		case 0x3: return !cpu.c;
+		case 0x4: return cpu.n;
+		case 0x5: return !cpu.n;
+		case 0x6: return cpu.v;
+		case 0x7: return !cpu.v;
+		case 0x8: return cpu.c && !cpu.z;
+		case 0x9: return !cpu.c || cpu.z;
+		case 0xA: return cpu.n == cpu.v;
+		case 0xB: return cpu.n != cpu.v;
+		case 0xC: return !cpu.z && (cpu.n == cpu.v);
+		default: return cpu.z || (cpu.n != cpu.v);
+	}
+}
+
+/* shift by register, amount is the bottom byte, carry as in ARMv6-M pseudocode */
+static uint32_t shift_register (uint32_t type, uint32_t value, uint32_t amount)
+{
+	amount &= 0xFF;
+	if (amount == 0)
+	{
+		return value;
+	}
+
+	switch (type)
+	{
+		case 0: /* LSL */
+			if (amount < 32)
+			{
+				cpu.c = (value >> (32 - amount)) & 1;
+				return value << amount;
+			}
+			cpu.c = (amount == 32) ? (value & 1) : 0;
+			return 0;
+		case 1: /* LSR */
+			if (amount < 32)
+			{
+				cpu.c = (value >> (amount - 1)) & 1;
+				return value >> amount;
+			}
+			cpu.c = (amount == 32) ? (value >> 31) : 0;
+			return 0;
+		case 2: /* ASR */
+			if (amount < 32)
+			{
+				cpu.c = (value >> (amount - 1)) & 1;
+				return (uint32_t)((int32_t)value >> amount);
+			}
+			cpu.c = value >> 31;
+			return (value >> 31) ? 0xFFFFFFFFul : 0;
+		default: /* ROR */
+			amount &= 31;
+			if (amount != 0)
+			{
+				value = (value >> amount) | (value << (32 - amount));
+			}
+			cpu.c = value >> 31;
+			return value;
+	}
+}
+
+/* interworking branch, Thumb bit must be set */
+static int bx_write_pc (uint32_t address)
+{
+	if (!(address & 1))
+	{
+		snprintf(error, sizeof(error), "branch to ARM state at 0x%08X", address);
+		return 0;
+	}
+	cpu.r[PC] = address & ~1ul;
+	return 1;
+}
+
+static int fetch (uint32_t address, uint32_t* op)
+{
+	region_t* region = region_of(address, 2);
+
+	if ((region == NULL) || (region->base != 0x00000000 && region->base != 0x10000000))
+	{
+		snprintf(error, sizeof(error), "execution at 0x%08X", address);
+		return 0;
+	}
+	*op = region->data[address - region->base] | ((uint32_t)region->data[address - region->base + 1] << 8);
+	return 1;
+}
+
+static int load_store_multiple (int load, uint32_t base, uint32_t list, uint32_t* end)
+{
+	uint32_t address = base;
+	uint32_t value;
+	int i;
+
+	for (i = 0; i < 16; i++)
+	{
+		if (!(list & (1ul << i)))
+		{
+			continue;
+		}
+		if (load)
+		{
+			if (!mem_read(address, 4, &value))
+			{
+				return 0;
+			}
+			if (i == PC)
+			{
+				if (!bx_write_pc(value))
+				{
+					return 0;
+				}
+			}
+			else
+			{
+				cpu.r[i] = value;
+			}
+		}
+		else if (!mem_write(address, 4, cpu.r[i]))
+		{
+			return 0;
+		}
+		address += 4;
+	}
+	*end = address;
+	return 1;
+}
+
+static uint32_t bit_count (uint32_t value)
+{
+	uint32_t count = 0;
+
+	for (; value != 0; value &= value - 1)
+	{
+		count++;
+	}
+	return count;
+}
+
+static uint32_t sign_extend (uint32_t value, int bits)
+{
+	uint32_t sign = 1ul << (bits - 1);
+
+	return (value ^ sign) - sign;
+}
+
+/* 32-bit instructions: BL, MSR, MRS, barriers */
+static int execute32 (uint32_t pc, uint32_t op1)
+{
+	uint32_t op2;
+	uint32_t imm;
+	uint32_t sysm;
+	uint32_t value;
+
+	if (!fetch(pc + 2, &op2))
+	{
+		return 0;
+	}
+	cpu.r[PC] = pc + 4;
+
+	if (((op1 & 0xF800) == 0xF000) && ((op2 & 0xD000) == 0xD000))
+	{
+		/* BL, imm32 = S:I1:I2:imm10:imm11:0, I1 = NOT(J1 XOR S), I2 = NOT(J2 XOR S) */
+		uint32_t s = (op1 >> 10) & 1;
+		uint32_t i1 = !(((op2 >> 13) & 1) ^ s);
+		uint32_t i2 = !(((op2 >> 11) & 1) ^ s);
+
+		imm = (s << 24) | (i1 << 23) | (i2 << 22) | ((op1 & 0x3FF) << 12) | ((op2 & 0x7FF) << 1);
+		cpu.r[LR] = (pc + 4) | 1;
+		cpu.r[PC] = pc + 4 + sign_extend(imm, 25);
+		cpu.cycles += 3;
+		return 1;
+	}
+
+	if (((op1 & 0xFFF0) == 0xF380) && ((op2 & 0xFF00) == 0x8800))
+	{
+		/* MSR */
+		value = cpu.r[op1 & 0xF];
+		sysm = op2 & 0xFF;
+		if (sysm <= 3)
+		{
+			cpu.n = (value >> 31) & 1;
+			cpu.z = (value >> 30) & 1;
+			cpu.c = (value >> 29) & 1;
+			cpu.v = (value >> 28) & 1;
+		}
+		else if (sysm == 8)
+		{
+			cpu.r[SP] = value & ~3ul;
+		}
+		else if (sysm == 16)
+		{
+			cpu.primask = value & 1;
+		}
+		cpu.cycles += 3;
+		return 1;
+	}
+
+	if ((op1 == 0xF3EF) && ((op2 & 0xF000) == 0x8000))
+	{
+		/* MRS, handlers run as calls, IPSR is 0 */
+		sysm = op2 & 0xFF;
+		value = 0;
+		if (sysm <= 3)
+		{
+			value = ((uint32_t)cpu.n << 31) | ((uint32_t)cpu.z << 30) | ((uint32_t)cpu.c << 29) | ((uint32_t)cpu.v << 28);
+		}
+		else if (sysm == 8)
+		{
+			value = cpu.r[SP];
+		}
+		else if (sysm == 16)
+		{
+			value = cpu.primask;
+		}
+		cpu.r[(op2 >> 8) & 0xF] = value;
+		cpu.cycles += 3;
+		return 1;
+	}
+
+	if ((op1 == 0xF3BF) && ((op2 & 0xFF00) == 0x8F00) && (((op2 >> 4) & 0xF) >= 4) && (((op2 >> 4) & 0xF) <= 6))
+	{
+		/* DSB, DMB, ISB */
+		cpu.cycles += 3;
+		return 1;
+	}
+
+	snprintf(error, sizeof(error), "undefined instruction %04X %04X at 0x%08X", op1, op2, pc);
+	return 0;
+}
+
+/* One instruction, 0 on error */
+static int execute (void)
+{
+	uint32_t pc = cpu.r[PC];
+	uint32_t op;
+	uint32_t rd, rn, rm;
+	uint32_t address;
+	uint32_t value;
+	uint32_t imm;
+	uint32_t end;
+	uint32_t list;
+
+	if (!fetch(pc, &op))
+	{
+		return 0;
+	}
+
+	if ((op & 0xF800) >= 0xE800)
+	{
+		return execute32(pc, op);
+	}
+
+	cpu.r[PC] = pc + 2;
+	rd = op & 0x7;
+	rn = (op >> 3) & 0x7;
+	rm = (op >> 6) & 0x7;
+
+	switch (op >> 12)
+	{
+		case 0x0:
+		case 0x1:
+			if ((op & 0x1800) != 0x1800)
+			{
+				/* LSL, LSR, ASR immediate */
+				imm = (op >> 6) & 0x1F;
+				value = cpu.r[rn];
+				switch ((op >> 11) & 3)
+				{
+					case 0:
+						if (imm != 0)
+						{
+							cpu.c = (value >> (32 - imm)) & 1;
+							value <<= imm;
+						}
+						break;
+					case 1:
+						imm = (imm == 0) ? 32 : imm;
+						cpu.c = (value >> (imm - 1)) & 1;
+						value = (imm == 32) ? 0 : (value >> imm);
+						break;
+					default:
+						imm = (imm == 0) ? 32 : imm;
+						cpu.c = (value >> (imm - 1)) & 1;
+						value = (imm == 32) ? ((value >> 31) ? 0xFFFFFFFFul : 0) : (uint32_t)((int32_t)value >> imm);
+						break;
+				}
+				set_nz(value);
+				cpu.r[rd] = value;
+			}
+			else
+			{
+				/* ADD, SUB register or 3-bit immediate */
+				value = (op & 0x0400) ? ((op >> 6) & 0x7) : cpu.r[rm];
+				if (op & 0x0200)
+				{
+					cpu.r[rd] = add_with_carry(cpu.r[rn], ~value, 1, 1);
+				}
+				else
+				{
+					cpu.r[rd] = add_with_carry(cpu.r[rn], value, 0, 1);
+				}
+			}
+			cpu.cycles += 1;
+			return 1;
+
+		case 0x2:
+		case 0x3:
+			/* MOV, CMP, ADD, SUB 8-bit immediate */
+			rd = (op >> 8) & 0x7;
+			imm = op & 0xFF;
+			switch ((op >> 11) & 3)
+			{
+				case 0:
+					cpu.r[rd] = imm;
+					set_nz(imm);
+					break;
+				case 1:
+					add_with_carry(cpu.r[rd], ~imm, 1, 1);
+					break;
+				case 2:
+					cpu.r[rd] = add_with_carry(cpu.r[rd], imm, 0, 1);
+					break;
+				default:
+					cpu.r[rd] = add_with_carry(cpu.r[rd], ~imm, 1, 1);
+					break;
+			}
+			cpu.cycles += 1;
+			return 1;
+
+		case 0x4:
+			if ((op & 0x0C00) == 0x0000)
+			{
+				/* data processing, Rdn and Rm */
+				uint32_t a = cpu.r[rd];
+				uint32_t b = cpu.r[rn];
+
+				switch ((op >> 6) & 0xF)
+				{
+					case 0x0: value = a & b; set_nz(value); cpu.r[rd] = value; break;
+					case 0x1: value = a ^ b; set_nz(value); cpu.r[rd] = value; break;
+					case 0x2: value = shift_register(0, a, b); set_nz(value); cpu.r[rd] = value; break;
+					case 0x3: value = shift_register(1, a, b); set_nz(value); cpu.r[rd] = value; break;
+					case 0x4: value = shift_register(2, a, b); set_nz(value); cpu.r[rd] = value; break;
+					case 0x5: cpu.r[rd] = add_with_carry(a, b, cpu.c, 1); break;
+					case 0x6: cpu.r[rd] = add_with_carry(a, ~b, cpu.c, 1); break;
+					case 0x7: value = shift_register(3, a, b); set_nz(value); cpu.r[rd] = value; break;
+					case 0x8: set_nz(a & b); break;
+					case 0x9: cpu.r[rd] = add_with_carry(~b, 0, 1, 1); break; /* RSB #0 */
+					case 0xA: add_with_carry(a, ~b, 1, 1); break;
+					case 0xB: add_with_carry(a, b, 0, 1); break;
+					case 0xC: value = a | b; set_nz(value); cpu.r[rd] = value; break;
+					case 0xD: value = a * b; set_nz(value); cpu.r[rd] = value; break;
+					case 0xE: value = a & ~b; set_nz(value); cpu.r[rd] = value; break;
+					default: value = ~b; set_nz(value); cpu.r[rd] = value; break;
+				}
+				cpu.cycles += 1;
+				return 1;
+			}
+			if ((op & 0x0C00) == 0x0400)
+			{
+				/* ADD, CMP, MOV of high registers, BX, BLX */
+				rd = ((op >> 4) & 0x8) | (op & 0x7);
+				rm = (op >> 3) & 0xF;
+				value = (rm == PC) ? (pc + 4) : cpu.r[rm];
+				switch ((op >> 8) & 3)
+				{
+					case 0:
+						value += (rd == PC) ? (pc + 4) : cpu.r[rd];
+						/* fall through */
+					case 2:
+						if (rd == PC)
+						{
+							cpu.r[PC] = value & ~1ul;
+							cpu.cycles += 2;
+						}
+						else
+						{
+							cpu.r[rd] = value;
+							cpu.cycles += 1;
+						}
+						return 1;
+					case 1:
+						add_with_carry((rd == PC) ? (pc + 4) : cpu.r[rd], ~value, 1, 1);
+						cpu.cycles += 1;
+						return 1;
+					default:
+						if (op & 0x80)
+						{
+							cpu.r[LR] = (pc + 2) | 1;
+						}
+						cpu.cycles += 2;
+						return bx_write_pc(value);
+				}
+			}
+			/* LDR literal */
+			address = ((pc + 4) & ~3ul) + ((op & 0xFF) << 2);
+			cpu.cycles += access_cycles(address);
+			return mem_read(address, 4, &cpu.r[(op >> 8) & 0x7]);
+
+		case 0x5:
+			/* load and store, register offset */
+			address = cpu.r[rn] + cpu.r[rm];
+			cpu.cycles += access_cycles(address);
+			switch ((op >> 9) & 0x7)
+			{
+				case 0: return mem_write(address, 4, cpu.r[rd]);
+				case 1: return mem_write(address, 2, cpu.r[rd]);
+				case 2: return mem_write(address, 1, cpu.r[rd]);
+				case 3:
+					if (!mem_read(address, 1, &value)) return 0;
+					cpu.r[rd] = sign_extend(value, 8);
+					return 1;
+				case 4: return mem_read(address, 4, &cpu.r[rd]);
+				case 5: return mem_read(address, 2, &cpu.r[rd]);
+				case 6: return mem_read(address, 1, &cpu.r[rd]);
+				default:
+					if (!mem_read(address, 2, &value)) return 0;
+					cpu.r[rd] = sign_extend(value, 16);
+					return 1;
+			}
+
+		case 0x6:
+		case 0x7:
+			/* LDR, STR word and byte, 5-bit immediate */
+			imm = (op >> 6) & 0x1F;
+			if (op & 0x1000)
+			{
+				address = cpu.r[rn] + imm;
+				cpu.cycles += access_cycles(address);
+				return (op & 0x0800) ? mem_read(address, 1, &cpu.r[rd]) : mem_write(address, 1, cpu.r[rd]);
+			}
+			address = cpu.r[rn] + (imm << 2);
+			cpu.cycles += access_cycles(address);
+			return (op & 0x0800) ? mem_read(address, 4, &cpu.r[rd]) : mem_write(address, 4, cpu.r[rd]);
+
+		case 0x8:
+			/* LDRH, STRH 5-bit immediate */
+			address = cpu.r[rn] + (((op >> 6) & 0x1F) << 1);
+			cpu.cycles += access_cycles(address);
+			return (op & 0x0800) ? mem_read(address, 2, &cpu.r[rd]) : mem_write(address, 2, cpu.r[rd]);
+
+		case 0x9:
+			/* LDR, STR SP relative */
+			address = cpu.r[SP] + ((op & 0xFF) << 2);
+			cpu.cycles += 2;
+			return (op & 0x0800) ? mem_read(address, 4, &cpu.r[(op >> 8) & 0x7]) : mem_write(address, 4, cpu.r[(op >> 8) & 0x7]);
+
+		case 0xA:
+			/* ADR, ADD Rd, SP, #imm8 */
+			imm = (op & 0xFF) << 2;
+			cpu.r[(op >> 8) & 0x7] = ((op & 0x0800) ? cpu.r[SP] : ((pc + 4) & ~3ul)) + imm;
+			cpu.cycles += 1;
+			return 1;
+
+		case 0xB:
+			if ((op & 0xFF00) == 0xB000)
+			{
+				/* ADD, SUB SP */
+				imm = (op & 0x7F) << 2;
+				cpu.r[SP] = (op & 0x80) ? (cpu.r[SP] - imm) : (cpu.r[SP] + imm);
+				cpu.cycles += 1;
+				return 1;
+			}
+			if ((op & 0xFF00) == 0xB200)
+			{
+				/* SXTH, SXTB, UXTH, UXTB */
+				value = cpu.r[rn];
+				switch ((op >> 6) & 3)
+				{
+					case 0: value = sign_extend(value & 0xFFFF, 16); break;
+					case 1: value = sign_extend(value & 0xFF, 8); break;
+					case 2: value &= 0xFFFF; break;
+					default: value &= 0xFF; break;
+				}
+				cpu.r[rd] = value;
+				cpu.cycles += 1;
+				return 1;
+			}
+			if ((op & 0xFE00) == 0xB400)
+			{
+				/* PUSH */
+				list = (op & 0xFF) | ((op & 0x100) ? (1ul << LR) : 0);
+				address = cpu.r[SP] - 4 * bit_count(list);
+				cpu.cycles += 1 + bit_count(list);
+				if (!load_store_multiple(0, address, list, &end))
+				{
+					return 0;
+				}
+				cpu.r[SP] = address;
+				return 1;
+			}
+			if ((op & 0xFFEF) == 0xB662)
+			{
+				/* CPSID i, CPSIE i */
+				cpu.primask = (op >> 4) & 1;
+				cpu.cycles += 1;
+				return 1;
+			}
+			if (((op & 0xFF00) == 0xBA00) && (((op >> 6) & 3) != 2))
+			{
+				/* REV, REV16, REVSH */
+				value = cpu.r[rn];
+				switch ((op >> 6) & 3)
+				{
+					case 0:
+						value = (value >> 24) | ((value >> 8) & 0xFF00) | ((value << 8) & 0xFF0000) | (value << 24);
+						break;
+					case 1:
+						value = ((value >> 8) & 0x00FF00FF) | ((value << 8) & 0xFF00FF00);
+						break;
+					default:
+						value = sign_extend(((value >> 8) & 0xFF) | ((value & 0xFF) << 8), 16);
+						break;
+				}
+				cpu.r[rd] = value;
+				cpu.cycles += 1;
+				return 1;
+			}
+			if ((op & 0xFE00) == 0xBC00)
+			{
+				/* POP, with PC a return */
+				list = (op & 0xFF) | ((op & 0x100) ? (1ul << PC) : 0);
+				address = cpu.r[SP];
+				cpu.r[SP] = address + 4 * bit_count(list);
+				cpu.cycles += ((op & 0x100) ? 3 : 1) + bit_count(list);
+				return load_store_multiple(1, address, list, &end);
+			}
+			if (op == 0xBF00)
+			{
+				/* NOP */
+				cpu.cycles += 1;
+				return 1;
+			}
+			break;
+
+		case 0xC:
+			/* STM, LDM, base written back unless loaded */
+			rn = (op >> 8) & 0x7;
+			list = op & 0xFF;
+			cpu.cycles += 1 + bit_count(list);
+			if (!load_store_multiple(op & 0x0800, cpu.r[rn], list, &end))
+			{
+				return 0;
+			}
+			if (!(op & 0x0800) || !(list & (1ul << rn)))
+			{
+				cpu.r[rn] = end;
+			}
+			return 1;
+
+		case 0xD:
+			if ((op & 0x0F00) >= 0x0E00)
+			{
+				/* UDF, SVC */
+				break;
+			}
+			if (condition((op >> 8) & 0xF))
+			{
+				cpu.r[PC] = pc + 4 + sign_extend((op & 0xFF) << 1, 9);
+				cpu.cycles += 2;
+			}
+			else
+			{
+				cpu.cycles += 1;
+			}
+			return 1;
+
+		case 0xE:
+			/* B */
+			cpu.r[PC] = pc + 4 + sign_extend((op & 0x7FF) << 1, 12);
+			cpu.cycles += 2;
+			return 1;
+	}
+
+	snprintf(error, sizeof(error), "unsupported instruction %04X at 0x%08X", op, pc);
+	return 0;
+}
+
+/* Function of the image called with up to 4 arguments on empty stack, returns r0. Cycles of
+the call are added to cpu.cycles, 0 on error */
+static int call (uint32_t function, const uint32_t* args, uint32_t* result)
+{
+	uint64_t start = cpu.cycles;
+	int i;
+
+	for (i = 0; i < 4; i++)
+	{
+		cpu.r[i] = (args != NULL) ? args[i] : 0;
+	}
+	cpu.r[SP] = image.stack_top;
+	cpu.r[LR] = RETURN_ADDRESS;
+	cpu.r[PC] = function & ~1ul;
+
+	while (cpu.r[PC] != (RETURN_ADDRESS & ~1ul))
+	{
+		if (!execute())
+		{
+			return 0;
+		}
+		if (cpu.cycles - start > CALL_MAX_CYCLES)
+		{
+			snprintf(error, sizeof(error), "no return of 0x%08X in %lu cycles", function, CALL_MAX_CYCLES);
+			return 0;
+		}
+	}
+
+	if (cpu.r[SP] != image.stack_top)
+	{
+		snprintf(error, sizeof(error), "stack pointer not restored by 0x%08X", function);
+		return 0;
+	}
+
+	if (result != NULL)
+	{
+		*result = cpu.r[0];
+	}
+	return 1;
+}
+
+static int call_failed (const char* what)
+{
+	fprintf(stderr, "cycle_sim: %s: %s (pc 0x%08X)\n", what, error, cpu.r[PC]);
+	return 2;
+}
+
+/* ---- ELF image ---- */
+
+static uint32_t get16 (const uint8_t* p)
+{
+	return p[0] | ((uint32_t)p[1] << 8);
+}
+
+static uint32_t get32 (const uint8_t* p)
+{
+	return p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint8_t* read_file (const char* name, long* size)
+{
+	FILE* file;
+	uint8_t* data;
+
+	file = fopen(name, "rb");
+	if (file == NULL)
+	{
+		perror(name);
+		return NULL;
+	}
+	fseek(file, 0, SEEK_END);
+	*size = ftell(file);
+	fseek(file, 0, SEEK_SET);
+	data = malloc(*size + 1);
+	if ((data == NULL) || (fread(data, 1, *size, file) != (size_t)*size))
+	{
+		fprintf(stderr, "cannot read %s\n", name);
+		fclose(file);
+		free(data);
+		return NULL;
+	}
+	data[*size] = 0;
+	fclose(file);
+	return data;
+}
+
+/* string of the image, or of its file for sections not loaded */
+static void image_string (uint32_t address, char* text, int size)
+{
+	uint32_t value;
+	int i;
+
+	for (i = 0; i < size - 1; i++)
+	{
+		if (!mem_read(address + i, 1, &value) || (value == 0))
+		{
+			break;
+		}
+		text[i] = (char)value;
+	}
+	text[i] = 0;
+}
+
+/* Sections with SHF_ALLOC go to their run addresses (initialized RAM as after Reset_Handler),
+symbols of the bench are looked up, compiler comes from .comment */
+static int load_image (const char* name)
+{
+	uint8_t* elf;
+	long size;
+	const uint8_t* sections;
+	const uint8_t* section;
+	const uint8_t* symbols = NULL;
+	const char* strings = NULL;
+	const char* section_names;
+	const char* symbol;
+	const char* comment;
+	uint32_t symbols_size = 0;
+	uint32_t sh_size;
+	uint32_t address;
+	uint32_t value;
+	uint32_t i;
+	uint32_t count;
+	uint32_t entry_size;
+	region_t* region;
+	char config[MAX_KEY];
+	int key_length = 0;
+
+	elf = read_file(name, &size);
+	if (elf == NULL)
+	{
+		return 0;
+	}
+
+	if ((size < 52) || (memcmp(elf, "\177ELF", 4) != 0) || (elf[4] != 1) || (elf[5] != 1) || (get16(elf + 18) != 40))
+	{
+		fprintf(stderr, "%s: not a 32-bit little endian ARM ELF file\n", name);
+		return 0;
+	}
+
+	sections = elf + get32(elf + 32);
+	entry_size = get16(elf + 46);
+	count = get16(elf + 48);
+	section_names = (const char*)elf + get32(sections + get16(elf + 50) * entry_size + 16);
+
+	for (i = 0; i < count; i++)
+	{
+		section = sections + i * entry_size;
+		sh_size = get32(section + 20);
+		address = get32(section + 12);
+
+		if (get32(section + 4) == 2) /* SHT_SYMTAB */
+		{
+			symbols = elf + get32(section + 16);
+			symbols_size = sh_size;
+			strings = (const char*)elf + get32(sections + get32(section + 24) * entry_size + 16);
+		}
+
+		if (strcmp(section_names + get32(section), ".comment") == 0)
+		{
+			/* compilers, the linker is not part of the key */
+			for (comment = (const char*)elf + get32(section + 16); comment < (const char*)elf + get32(section + 16) + sh_size; comment += strlen(comment) + 1)
+			{
+				if ((*comment != 0) && (strncmp(comment, "Linker:", 7) != 0) && (key_length + strlen(comment) + 3 < MAX_KEY))
+				{
+					key_length += sprintf(image.key + key_length, "%s%s", (key_length > 0) ? "; " : "", comment);
+				}
+			}
+		}
+
+		if (!(get32(section + 8) & 0x2) || (sh_size == 0)) /* SHF_ALLOC */
+		{
+			continue;
+		}
+
+		region = region_of(address, sh_size);
+		if (region == NULL)
+		{
+			fprintf(stderr, "%s: section %s at 0x%08X outside of memory\n", name, section_names + get32(section), address);
+			return 0;
+		}
+		if (get32(section + 4) != 8) /* not SHT_NOBITS */
+		{
+			memcpy(&region->data[address - region->base], elf + get32(section + 16), sh_size);
+		}
+	}
+
+	if (symbols == NULL)
+	{
+		fprintf(stderr, "%s: no symbol table\n", name);
+		return 0;
+	}
+
+	for (i = 0; i < symbols_size; i += 16)
+	{
+		symbol = strings + get32(symbols + i);
+		value = get32(symbols + i + 4);
+
+		if (strcmp(symbol, "__StackTop") == 0) image.stack_top = value;
+		else if (strcmp(symbol, "__StackLimit") == 0) image.stack_limit = value;
+		else if (strcmp(symbol, "bench_init") == 0) image.bench_init = value;
+		else if (strcmp(symbol, "bench_name") == 0) image.bench_name = value;
+		else if (strcmp(symbol, "bench_cases") == 0) image.bench_cases = value;
+		else if (strcmp(symbol, "bench_prepare") == 0) image.bench_prepare = value;
+		else if (strcmp(symbol, "bench_call") == 0) image.bench_call = value;
+		else if (strcmp(symbol, "bench_config") == 0) image.bench_config = value;
+	}
+	free(elf);
+
+	if (!image.stack_top || !image.bench_init || !image.bench_name || !image.bench_cases ||
+		!image.bench_prepare || !image.bench_call || !image.bench_config)
+	{
+		fprintf(stderr, "%s: not a cycle bench image (symbols of cycle_bench.c missing)\n", name);
+		return 0;
+	}
+
+	/* whole stack painted as by Reset_Handler, stack_used (GET|STACK_USAGE) scans it */
+	for (address = image.stack_limit; (address != 0) && (address < image.stack_top); address += 4)
+	{
+		mem_write(address, 4, STACK_PAINT);
+	}
+	/* clocks as the board runs them, main clock is the crystal (PLL input from system oscillator) */
+	mem_write(SYSCON_SYSPLLCLKSEL, 4, 1);
+	mem_write(SYSCON_MAINCLKSEL, 4, 1);
+	mem_write(SYSCON_SYSAHBCLKDIV, 4, 1);
+
+	image_string(image.bench_config, config, sizeof(config));
+	if (key_length + strlen(config) + 3 < MAX_KEY)
+	{
+		snprintf(image.key + key_length, MAX_KEY - key_length, "; %s", config);
+	}
+
+	return 1;
+}
+
+/* ---- baselines ---- */
+
+static char* baseline_lines[MAX_BASELINE_LINES];
+static int baseline_lines_num;
+
+static int section_header (const char* line, char* key)
+{
+	const char* end;
+
+	if (line[0] != '[')
+	{
+		return 0;
+	}
+	end = strrchr(line, ']');
+	if ((end == NULL) || (end - line - 1 >= MAX_KEY))
+	{
+		return 0;
+	}
+	memcpy(key, line + 1, end - line - 1);
+	key[end - line - 1] = 0;
+	return 1;
+}
+
+/* Lines of baseline file are kept for -u, 0 when the file cannot be read (a new one is written) */
+static int baseline_read (const char* name, int* found)
+{
+	FILE* file;
+	char line[MAX_LINE];
+	char key[MAX_KEY];
+	char path_name[MAX_NAME];
+	unsigned max;
+	unsigned long long total;
+	int in_section = 0;
+	int i;
+
+	*found = 0;
+	file = fopen(name, "r");
+	if (file == NULL)
+	{
+		return 0;
+	}
+
+	while ((fgets(line, sizeof(line), file) != NULL) && (baseline_lines_num < MAX_BASELINE_LINES))
+	{
+		baseline_lines[baseline_lines_num++] = strdup(line);
+		line[strcspn(line, "\r\n")] = 0;
+
+		if (section_header(line, key))
+		{
+			in_section = (strcmp(key, image.key) == 0);
+			*found |= in_section;
+			continue;
+		}
+		if (!in_section || (sscanf(line, "%31s %u %llu", path_name, &max, &total) != 3))
+		{
+			continue;
+		}
+		for (i = 0; i < paths_num; i++)
+		{
+			if (strcmp(paths[i].name, path_name) == 0)
+			{
+				paths[i].baseline = 1;
+				paths[i].baseline_max = max;
+				paths[i].baseline_total = total;
+			}
+		}
+	}
+	fclose(file);
+
+	return 1;
+}
+
+/* Section of the image replaced in place or added at the end, other sections are kept */
+static int baseline_write (const char* name)
+{
+	FILE* file;
+	char key[MAX_KEY];
+	int in_section = 0;
+	int written = 0;
+	int i;
+	int j;
+
+	file = fopen(name, "w");
+	if (file == NULL)
+	{
+		perror(name);
+		return 0;
+	}
+
+	if (baseline_lines_num == 0)
+	{
+		fprintf(file, "# Cycle baselines of cycle_bench.elf (cycle_sim, README.md), written by cycle_sim -u.\n"
+			"# One section per compiler and build options, path, worst case and sum of all cases\n");
+	}
+
+	for (i = 0; i <= baseline_lines_num; i++)
+	{
+		if ((i == baseline_lines_num) || section_header(baseline_lines[i], key))
+		{
+			if (in_section || ((i == baseline_lines_num) && !written))
+			{
+				if (!in_section)
+				{
+					fprintf(file, "\n");
+				}
+				fprintf(file, "[%s]\n", image.key);
+				for (j = 0; j < paths_num; j++)
+				{
+					fprintf(file, "%-24s %8u %12llu\n", paths[j].name, paths[j].max, (unsigned long long)paths[j].total);
+				}
+				written = 1;
+			}
+			if (i == baseline_lines_num)
+			{
+				break;
+			}
+			in_section = (strcmp(key, image.key) == 0);
+			if (in_section)
+			{
+				continue;
+			}
+		}
+		if (!in_section)
+		{
+			fputs(baseline_lines[i], file);
+		}
+	}
+
+	fclose(file);
+	return 1;
+}
+
+/* ---- bench ---- */
+
+static int run_bench (int verbose)
+{
+	uint32_t args[2];
+	uint32_t call_words[5]; /* bench_call_t: function, r0-r3 */
+	uint32_t name;
+	uint32_t value;
+	uint32_t budget;
+	uint32_t cycles;
+	uint64_t start;
+	path_t* path;
+	unsigned index;
+	int i;
+
+	if (!call(image.bench_init, NULL, &value))
+	{
+		return call_failed("bench_init");
+	}
+	paths_num = (value < MAX_PATHS) ? (int)value : MAX_PATHS;
+
+	for (i = 0; i < paths_num; i++)
+	{
+		path = &paths[i];
+		args[0] = i;
+		if (!call(image.bench_name, args, &name) || !call(image.bench_cases, args, &value))
+		{
+			return call_failed("bench path");
+		}
+		image_string(name, path->name, MAX_NAME);
+		path->cases = value;
+		path->min = 0xFFFFFFFFul;
+
+		for (index = 0; index < path->cases; index++)
+		{
+			args[1] = index;
+			if (!call(image.bench_prepare, args, &budget))
+			{
+				return call_failed(path->name);
+			}
+			for (value = 0; value < 5; value++)
+			{
+				mem_read(image.bench_call + value * 4, 4, &call_words[value]);
+			}
+
+			/* line is idle at the start of each case */
+			tx_busy = 0;
+			start = cpu.cycles;
+			if (!call(call_words[0], &call_words[1], NULL))
+			{
+				return call_failed(path->name);
+			}
+			cycles = (uint32_t)(cpu.cycles - start);
+
+			if (verbose)
+			{
+				printf("%-24s %5u %8u\n", path->name, index, cycles);
+			}
+			path->total += cycles;
+			if (cycles < path->min)
+			{
+				path->min = cycles;
+			}
+			if (cycles > path->max)
+			{
+				path->max = cycles;
+			}
+			/* each case against the budget at its clock rate */
+			if (budget > 0)
+			{
+				path->over_budget += (cycles > budget);
+				if ((path->budget == 0) || (budget < path->budget))
+				{
+					path->budget = budget;
+				}
+			}
+		}
+	}
+
+	return 0;
+}
+
+int main (int argc, char** argv)
+{
+	const char* baseline_name = NULL;
+	const char* image_name = NULL;
+	int update = 0;
+	int verbose = 0;
+	int found = 0;
+	int failed = 0;
+	int result;
+	int arg;
+	int i;
+	char status[64];
+	path_t* path;
+
+	for (arg = 1; arg < argc; arg++)
+	{
+		if ((strcmp(argv[arg], "-b") == 0) && (arg + 1 < argc))
+		{
+			baseline_name = argv[++arg];
+		}
+		else if (strcmp(argv[arg], "-u") == 0)
+		{
+			update = 1;
+		}
+		else if (strcmp(argv[arg], "-v") == 0)
+		{
+			verbose = 1;
+		}
+		else if ((argv[arg][0] != '-') && (image_name == NULL))
+		{
+			image_name = argv[arg];
+		}
+		else
+		{
+			image_name = NULL;
+			break;
+		}
+	}
+	if ((image_name == NULL) || (update && (baseline_name == NULL)))
+	{
+		fprintf(stderr, "usage: %s [-v] [-u] [-b baseline] bench.elf\n", argv[0]);
+		return 2;
+	}
+
+	for (i = 0; i < (int)REGIONS_NUM; i++)
+	{
+		regions[i].data = calloc(regions[i].size, 1);
+		if (regions[i].data == NULL)
+		{
+			return 2;
+		}
+	}
+
+	if (!load_image(image_name))
+	{
+		return 2;
+	}
+
+	result = run_bench(verbose);
+	if (result != 0)
+	{
+		return result;
+	}
+
+	if (baseline_name != NULL)
+	{
+		baseline_read(baseline_name, &found);
+	}
+
+	printf("%s\n", image.key);
+	printf("%-24s %5s %8s %8s %10s %8s %8s  %s\n", "path", "cases", "min", "max", "total", "budget", "baseline", "status");
+	for (i = 0; i < paths_num; i++)
+	{
+		path = &paths[i];
+		strcpy(status, "ok");
+
+		if (path->over_budget > 0)
+		{
+			sprintf(status, "OVER BUDGET (%u cases)", path->over_budget);
+			failed = 1;
+		}
+		else if (!update && path->baseline && ((path->max > path->baseline_max) || (path->total > path->baseline_total)))
+		{
+			sprintf(status, "OVER BASELINE (%+ld max, %+lld total)", (long)path->max - (long)path->baseline_max,
+				(long long)path->total - (long long)path->baseline_total);
+			failed = 1;
+		}
+		else if (!update && path->baseline && ((path->max < path->baseline_max) || (path->total < path->baseline_total)))
+		{
+			strcpy(status, "below baseline, record it with -u");
+		}
+		else if (!update && found && !path->baseline)
+		{
+			strcpy(status, "no baseline");
+		}
+
+		printf("%-24s %5u %8u %8u %10llu ", path->name, path->cases, path->min, path->max, (unsigned long long)path->total);
+		if (path->budget > 0)
+		{
+			printf("%8u ", path->budget);
+		}
+		else
+		{
+			printf("%8s ", "-");
+		}
+		if (path->baseline)
+		{
+			printf("%8u ", path->baseline_max);
+		}
+		else
+		{
+			printf("%8s ", "-");
+		}
+		printf(" %s\n", status);
+	}
+
+	if (update)
+	{
+		if (!baseline_write(baseline_name))
+		{
+			return 2;
+		}
+		printf("baseline of this image written to %s\n", baseline_name);
+	}
+	else if ((baseline_name != NULL) && !found)
+	{
+		printf("no baseline of this image in %s, only budgets are checked (record one with -u)\n", baseline_name);
+	}
+
+	return failed;
+}
@@ -2,126 +2,68 @@
 
 #define SYSTICKRATE_HZ 1
 
-const uint32_t OscRateIn = 18432000ul;
-const uint32_t ExtRateIn = 0;
+/* Anode pins in order of tube masks (bit 0 = seconds) */
+const uint8_t anode_pin[BOARD_TUBES] = {
+	BOARD_ANODE_0, BOARD_ANODE_1, BOARD_ANODE_2, BOARD_ANODE_3, BOARD_ANODE_4, BOARD_ANODE_5
+};
 
-uint32_t SysTick_Config_half(uint32_t ticks)
-{
-  if ((ticks - 1UL) > SysTick_LOAD_RELOAD_Msk)
-  {
-    return (1UL);                                                   /* Reload value impossible */
-  }
+/* Decoder input pins of each number, remap of decoder and order of BCD pins included */
+static const uint32_t digit_pins[16] = {
+	BCD_PINS(BOARD_DIGIT_0), BCD_PINS(BOARD_DIGIT_1), BCD_PINS(BOARD_DIGIT_2), BCD_PINS(BOARD_DIGIT_3),
+	BCD_PINS(BOARD_DIGIT_4), BCD_PINS(BOARD_DIGIT_5), BCD_PINS(BOARD_DIGIT_6), BCD_PINS(BOARD_DIGIT_7),
+	BCD_PINS(BOARD_DIGIT_8), BCD_PINS(BOARD_DIGIT_9), BCD_PINS(10), BCD_PINS(11),
+	BCD_PINS(12), BCD_PINS(13), BCD_PINS(14), BCD_PINS(15)
+};
 
-  SysTick->LOAD  = (uint32_t)(ticks - 1UL);                         /* set reload register */
-  NVIC_SetPriority (SysTick_IRQn, (1UL << __NVIC_PRIO_BITS) - 1UL); /* set Priority for Systick Interrupt */
-  SysTick->VAL   = 0UL;                                             /* Load the SysTick Counter Value */
-  SysTick->CTRL  = /*SysTick_CTRL_CLKSOURCE_Msk |*/
-                   SysTick_CTRL_TICKINT_Msk   |
-                   SysTick_CTRL_ENABLE_Msk;                         /* Enable SysTick IRQ and SysTick Timer */
-  return (0UL);                                                     /* Function successful */
-}
+#ifdef BCD_TIME
+/* packed BCD 00-59 to binary, invalid codes give 0 */
+#define BCD_TENS(t) (t)*10, (t)*10+1, (t)*10+2, (t)*10+3, (t)*10+4, (t)*10+5, (t)*10+6, (t)*10+7, (t)*10+8, (t)*10+9, 0, 0, 0, 0, 0, 0
+const uint8_t bcd_to_bin[0x60] = {
+	BCD_TENS(0), BCD_TENS(1), BCD_TENS(2), BCD_TENS(3), BCD_TENS(4), BCD_TENS(5)
+};
 
-void setupMRT(uint8_t ch, MRT_MODE_T mode, uint32_t rate)
-{
-	LPC_MRT_CH_T *pMRT;
+/* binary 0-59 to packed BCD */
+#define BIN_TENS(t) (t)<<4, ((t)<<4)|1, ((t)<<4)|2, ((t)<<4)|3, ((t)<<4)|4, ((t)<<4)|5, ((t)<<4)|6, ((t)<<4)|7, ((t)<<4)|8, ((t)<<4)|9
+const uint8_t bin_to_bcd[60] = {
+	BIN_TENS(0), BIN_TENS(1), BIN_TENS(2), BIN_TENS(3), BIN_TENS(4), BIN_TENS(5)
+};
+#endif
 
-	/* Get pointer to timer selected by ch */
-	pMRT = Chip_MRT_GetRegPtr(ch);
+/* limit of time field counted by second tick, in the format of clock time */
+#ifdef BCD_TIME
+	#define TICK_LIMIT(n) ((((n) / 10) << 4) | ((n) % 10))
+#else
+	#define TICK_LIMIT(n) (n)
+#endif
 
-	/* Setup timer with rate based on MRT clock */
-	Chip_MRT_SetInterval(pMRT, (Chip_Clock_GetSystemClockRate() / rate) |
-						 MRT_INTVAL_LOAD);
+static bool tick_inc (volatile uint8_t* field, uint8_t limit);
+static void day_inc (volatile time_t* time);
 
-	/* Timer mode */
-	Chip_MRT_SetMode(pMRT, mode);
+static void time_carry (volatile time_t* time, int8_t dec_inc_value, date_time what);
 
-	/* Clear pending interrupt and enable timer */
-	Chip_MRT_IntClear(pMRT);
-	Chip_MRT_SetEnabled(pMRT);
-}
+volatile uint8_t time_seq = 0;
+static volatile bool time_held = FALSE; /* interrupt work waits for end of main loop write */
+volatile bool display_dirty = TRUE;
 
 void board_init (void)
 {
-	/* Set port 0 pins 1, 4, 7, 10, 11, 13, 14, 15, 16 and 17 to the output direction*/
-	Chip_GPIO_SetPortDIROutput(LPC_GPIO_PORT, 0, OUT_PORT_MASK);
-	
-	/* Set port 0 pins 12 nad 5 to be input direction */
-	Chip_GPIO_SetPortDIRInput(LPC_GPIO_PORT, 0, IN_PORT_MASK);
-	
-	/* Connect the UART TX/RX signals to port pins 6 and 0) */
-	Chip_SWM_DisableFixedPin(SWM_FIXED_ACMP_I1);
-	Chip_SWM_MovablePinAssign(SWM_U0_TXD_O, TX_PIN);
-	Chip_SWM_MovablePinAssign(SWM_U0_RXD_I, RX_PIN);
-	
-	/* Set GPIO port mask value to make sure only port 0
-	are active during state change */
-	Chip_GPIO_SetPortMask(LPC_GPIO_PORT, 0, ~OUT_PORT_MASK);
-	
-	/* Set all out pins to 0 */
-	Chip_GPIO_SetMaskedPortValue(LPC_GPIO_PORT, 0, 0);
+	/* Set port 0 pins 1, 4, 7, 10, 11, 13, 14, 15, 16 and 17 to the output direction
+	and pins 12 and 5 to be input direction, all out pins to 0 */
+	hal_gpio_init(OUT_PORT_MASK, IN_PORT_MASK);
 	
-	/* Set Glitch filter for switchs*/
-	Chip_Clock_SetIOCONCLKDIV(IOCONCLKDIV1, 250);
-	Chip_IOCON_PinSetSampleMode(LPC_IOCON, IOCON_PIO12, PIN_SMODE_CYC3); //SW1 
-	Chip_IOCON_PinSetClockDivisor(LPC_IOCON, IOCON_PIO12, IOCONCLKDIV1);
-	Chip_IOCON_PinSetSampleMode(LPC_IOCON, IOCON_PIO5, PIN_SMODE_CYC3); //SW2
-	Chip_IOCON_PinSetClockDivisor(LPC_IOCON, IOCON_PIO5, IOCONCLKDIV1);
-	
-	/* Disable !RESET pin */
-	Chip_SWM_DisableFixedPin(SWM_FIXED_RST);
+	/* Connect the UART TX/RX signals, set glitch filter for switches and disable !RESET pin */
+	hal_pins_init(TX_PIN, RX_PIN, IN_PORT_MASK);
 	
 	/* Enable SysTick Timer */
-	SysTick_Config_half((OscRateIn/2) / SYSTICKRATE_HZ);
+	hal_systick_init(hal_systick_rate() / SYSTICKRATE_HZ);
 }
 
 
-void set_number (uint8_t number)
-{	
-#ifdef BOARD_REV1
-	work_around_7442_4028(&number);
-#endif
-	
-	Chip_GPIO_SetPinState (LPC_GPIO_PORT, 0, BCD_A, number & 0x01);
-	Chip_GPIO_SetPinState (LPC_GPIO_PORT, 0, BCD_B, number & 0x02);
-	Chip_GPIO_SetPinState (LPC_GPIO_PORT, 0, BCD_C, number & 0x04);
-	Chip_GPIO_SetPinState (LPC_GPIO_PORT, 0, BCD_D, number & 0x08);
-}
-
-void work_around_7442_4028 (uint8_t* number)
+/* Cathode of number is selected by writing its decoder input at once, values above 9 light nothing */
+HAL_RAMFUNC void set_number (uint8_t number)
 {
-	switch(*number)
-	{
-		case 0:
-			*number = 4;
-			break;
-		case 1:
-			*number = 2;
-			break;
-		case 2:
-			*number = 0;
-			break;			
-		case 3:
-			*number = 7;
-			break;
-		case 4:
-			*number = 9;
-			break;
-		case 5:
-			*number = 5;
-			break;
-		case 6:
-			*number = 6;
-			break;
-		case 7:
-			*number = 8;
-			break;
-		case 8:
-			*number = 1;
-			break;
-		case 9:
-			*number = 3;
-			break;
-	}
+	hal_gpio_clear_mask(BCD_MASK & ~digit_pins[number & 0x0F]);
+	hal_gpio_set_mask(digit_pins[number & 0x0F]);
 }
 
 uint8_t days_in_month (uint8_t month, uint16_t year)
@@ -139,19 +81,22 @@ uint8_t days_in_month (uint8_t month, uint16_t year)
 			days = 31;
 		}
 	}
-	else if (year % 4) /* leap year */
+	/* leap year, 2100 is not. Cortex-M0+ has no divider, year / 100 by multiplication is exact
+	below 43699, far past the years of the clock, and year divisible by 100 and 16 is by 400 */
+	else if (!(year % 4) && ((((year * 5243ul) >> 19) * 100 != year) || !(year % 16)))
 	{
-		days = 28;
+		days = 29;
 	}
 	else 
 	{
-		days = 29;
+		days = 28;
 	}
 	
 	return days;
 }
 
-void time_inc_dec(volatile time_t* time, int8_t dec_inc_value, date_time what)	
+/* Binary carry of time_inc_dec */
+static void time_carry (volatile time_t* time, int8_t dec_inc_value, date_time what)	
 {	
 	bool time_only;
 	
@@ -186,13 +131,13 @@ void time_inc_dec(volatile time_t* time, int8_t dec_inc_value, date_time what)
 		if (time->seconds > 59)
 		{
 			time->minutes++;
-			time->seconds = 0;
+			time->seconds -= 60;
 		}
 		
 		if (time->minutes > 59)
 		{
 			time->hours++;
-			time->minutes = 0;
+			time->minutes -= 60;
 		}
 		
 		if (time->hours > 23)
@@ -201,163 +146,219 @@ void time_inc_dec(volatile time_t* time, int8_t dec_inc_value, date_time what)
 			{
 				time->days++;
 			}
-			time->hours = 0;
+			time->hours -= 24;
 		}
 		
-		if (time->days > days_in_month(time->months, time->years))
+		if (time->months > 12)
 		{
-			time->months++;
-			time->days = 1;
+			time->years++;
+			time->months -= 12;
 		}
 		
-		if (time->months > 12)
+		/* day carries only when days or lower fields were added, higher ones clamp it below */
+		if ((what <= DAYS) && (time->days > days_in_month(time->months, time->years)))
 		{
-			time->years++;
-			time->months = 1;
-		}	
+			time->days -= days_in_month(time->months, time->years);
+			time->months++;
+			
+			if (time->months > 12)
+			{
+				time->years++;
+				time->months = 1;
+			}
+		}
 	}
 	else
 	{
-		if (time->seconds > 255)
+		/* fields are unsigned, value below zero wrapped to the top of 8-bit range */
+		if (time->seconds > 59)
 		{
 			time->minutes--;
-			time->seconds = 59;
+			time->seconds += 60;
 		}
 		
-		if (time->minutes == 255)
+		if (time->minutes > 59)
 		{
 			time->hours--;
-			time->minutes = 59;
+			time->minutes += 60;
 		}
-		if (time->hours == 255)
+		
+		if (time->hours > 23)
 		{
-			time->hours = 23;
+			if (!time_only)
+			{
+				time->days--;
+			}
+			time->hours += 24;
 		}
 		
-		if (time->days == 0)
+		if ((time->months == 0) || (time->months > 12))
 		{
-			time->months--;
-			time->days = days_in_month(time->months, time->years);
+			time->years--;
+			time->months += 12;
 		}
 		
-		if (time->months == 0)
+		if ((time->days == 0) || (time->days > 31))
 		{
-			time->years--;
-			time->months = 12;
-			
-			if (time->years < 2000)
+			time->months--;
+			if (time->months == 0)
 			{
-				time->years = 2000;
+				time->years--;
+				time->months = 12;
 			}
+			time->days += days_in_month(time->months, time->years);
 		}
+		
+		if (time->years < FIRST_YEAR)
+		{
+			time->years = FIRST_YEAR;
+			time->months = 1;
+			time->days = 1;
+			time->hours = 0;
+			time->minutes = 0;
+			time->seconds = 0;
+		}
+	}
+	
+	/* day could be out of range if month or year was changed (31.3. -> 28.2.) */
+	if (time->days > days_in_month(time->months, time->years))
+	{
+		time->days = days_in_month(time->months, time->years);
 	}
 }	
 
-
-void roll_numbers(volatile time_t* time, volatile display_t* user_data, volatile display_t *display)	
+/* Add/subtract value (less than range of the field) to one field and carry to higher fields,
+with TIME_ONLY hours wrap around without changing the date. Date does not go below 1.1.FIRST_YEAR */
+void time_inc_dec(volatile time_t* time, int8_t dec_inc_value, date_time what)
 {
-	static uint8_t over_date = 0;
-	static uint8_t over_time = 0;
-	static uint8_t over_user = 0;
-	static bool one_time_roll = FALSE;
-	bool finish = FALSE;
+#ifdef BCD_TIME
+	time_t bin;
+#endif
 	
-	if ((time->curr_displayed & ~LOCK) == DATE)/* mask LOCK since we don't care */
+	/* second tick counts time in its own format, only the change of date goes through carry,
+	date is binary in both and time is 0 at midnight */
+	if ((what == SECONDS) && (dec_inc_value == +1))
 	{
-		finish = roll(&display->seconds, to_BCD(year_to_number(time->years)), over_date);
-		finish &= roll(&display->minutes, to_BCD(time->months), over_date);
-		finish &= roll(&display->hours, to_BCD(time->days), over_date);
-
-		if (finish)
+		if (tick_inc(&time->seconds, TICK_LIMIT(60)) && tick_inc(&time->minutes, TICK_LIMIT(60)) &&
+			tick_inc(&time->hours, TICK_LIMIT(24)))
 		{
-			one_time_roll = TRUE;
-			over_time = 0;
-			over_user = 0;
-			
-			time->curr_displayed &= ~LOCK; /* unlock */
-		}	
-		else
-		{
-			over_date++; /* to roll over all 10 (0-9) digits */
+			day_inc(time);
 		}
+		return;
 	}
+	
+#ifdef BCD_TIME
+	bin.seconds = TIME_TO_BIN(time->seconds);
+	bin.minutes = TIME_TO_BIN(time->minutes);
+	bin.hours = TIME_TO_BIN(time->hours);
+	bin.days = time->days;
+	bin.months = time->months;
+	bin.years = time->years;
+	
+	time_carry(&bin, dec_inc_value, what);
+	
+	time->seconds = TIME_FROM_BIN(bin.seconds);
+	time->minutes = TIME_FROM_BIN(bin.minutes);
+	time->hours = TIME_FROM_BIN(bin.hours);
+	time->days = bin.days;
+	time->months = bin.months;
+	time->years = bin.years;
+#else
+	time_carry(time, dec_inc_value, what);
+#endif
+}
 
-	if ((time->curr_displayed & ~LOCK) == TIME) /* time */
+/* Increment of time field, packed BCD with decimal adjust, TRUE when it wrapped from limit to 0 */
+static bool tick_inc (volatile uint8_t* field, uint8_t limit)
+{
+	uint8_t value;
+	
+	value = *field + 1;
+#ifdef BCD_TIME
+	if ((value & 0x0F) > 9)
 	{
-		if (one_time_roll)
-		{
-			finish = roll(&display->seconds, to_BCD(time->seconds), over_time);
-			finish &= roll(&display->minutes, to_BCD(time->minutes), over_time);
-			finish &= roll(&display->hours, to_BCD(time->hours), over_time);
-			
-			if (finish)
-			{
-				one_time_roll = FALSE; /* prevents rolling seconds when they are changed under normal conditions */ 
-				over_date = 0;
-				over_user = 0;
-				
-				time->curr_displayed &= ~LOCK; /* unlock */
-			}
-			else
-			{
-				over_time++; /* to roll over all 10 (0-9) digits */
-			}
-		}
-		else
-		{
-			display->seconds = to_BCD(time->seconds);
-			display->minutes = to_BCD(time->minutes);
-			display->hours = to_BCD(time->hours);
-		}
+		value += 6;
 	}
+#endif
 	
-	if ((time->curr_displayed & ~LOCK) == USER_DATA)
+	if (value >= limit)
 	{
-		finish = roll(&display->seconds, to_BCD(user_data->seconds), over_user);
-		finish &= roll(&display->minutes, to_BCD(user_data->minutes), over_user);
-		finish &= roll(&display->hours, to_BCD(user_data->hours), over_user);
+		*field = 0;
+		return TRUE;
+	}
+	
+	*field = value;
+	return FALSE;
+}
+
+/* Next day at midnight of second tick, every month has 28 days at least */
+static void day_inc (volatile time_t* time)
+{
+	time->days++;
+	
+	if ((time->days > 28) && (time->days > days_in_month(time->months, time->years)))
+	{
+		time->days = 1;
+		time->months++;
 		
-		if (finish)
-		{
-			one_time_roll = TRUE;
-			over_date = 0;
-			over_time = 0;
-			
-			time->curr_displayed &= ~LOCK; /* unlock */
-		}
-		else
+		if (time->months > 12)
 		{
-			over_user++; /* to roll over all 10 (0-9) digits */
+			time->months = 1;
+			time->years++;
 		}
 	}
 }
 
-bool roll(volatile uint8_t* displayed, uint8_t needed, uint8_t over)	
+/* Change only one field of date/time, the field wraps around within its own range
+and does not carry to other fields (used by field-select editing in set mode) */
+void field_inc_dec (volatile time_t* time, int8_t dec_inc_value, date_time what)
 {
-	bool done = TRUE;
+	uint8_t max_day;
 	
-	/* end when new value to display found but continue rolling if not all combinations were iluminated */
-	if (((*displayed & 0x0F) != (needed & 0x0F)) || (over <= 9)) 
+	switch (what)
 	{
-		*displayed += 1;
-		if ((*displayed & 0x0F) > 0x09)
-		{
-			*displayed &= 0xF0;
-		}
-		done = FALSE;
+		case SECONDS:
+			time->seconds = TIME_FROM_BIN(wrap_value(TIME_TO_BIN(time->seconds) + dec_inc_value, 0, 59));
+			break;
+		case MINUTES:
+			time->minutes = TIME_FROM_BIN(wrap_value(TIME_TO_BIN(time->minutes) + dec_inc_value, 0, 59));
+			break;
+		case HOURS:
+			time->hours = TIME_FROM_BIN(wrap_value(TIME_TO_BIN(time->hours) + dec_inc_value, 0, 23));
+			break;
+		
+		case DAYS:
+			time->days = wrap_value(time->days + dec_inc_value, 1, days_in_month(time->months, time->years));
+			break;
+		case MONTHS:
+			time->months = wrap_value(time->months + dec_inc_value, 1, 12);
+			break;
+		case YEARS:
+			time->years = wrap_value(time->years + dec_inc_value, FIRST_YEAR, LAST_YEAR);
+			break;
 	}
-			
-	if (((*displayed & 0xF0) != (needed & 0xF0)) || (over <= 9))
+	
+	/* day could be out of range if month or year was changed (31.3. -> 28.2.) */
+	max_day = days_in_month(time->months, time->years);
+	if (time->days > max_day)
 	{
-		*displayed += 0x10;
-		if ((*displayed & 0xF0) > 0x90)
-		{
-			*displayed &= 0x0F;				
-		}
-		done = FALSE;
+		time->days = max_day;
+	}
+}
+
+/* expects step smaller than the range, therefore no division is needed */
+int16_t wrap_value (int16_t value, int16_t min, int16_t max)
+{
+	if (value > max)
+	{
+		value -= max - min + 1;
+	}
+	else if (value < min)
+	{
+		value += max - min + 1;
 	}
 	
-	return done;
+	return value;
 }
 
 uint8_t to_BCD (uint8_t number)
@@ -365,7 +366,56 @@ uint8_t to_BCD (uint8_t number)
 	return ((number / 10) << 4) | (number % 10);
 }
 
+/* two displayed digits of year, the clock keeps running after LAST_YEAR */
 uint8_t year_to_number (uint16_t year)
 {
-	return year - 2000;
+	return year % 100;
+}
+
+/* Clock time is written by interrupt work (PendSV) and by main loop (UART). Main loop
+brackets its writes, interrupt work is held back meanwhile and never sees a half-written
+time. Main loop readers copy the time again when interrupt work wrote it in the middle.
+Nobody disables interrupts */
+
+/* Main loop only */
+void time_write_begin (void)
+{
+	time_seq++;
+}
+
+/* Interrupt work, FALSE while main loop writes - work has to wait for time_write_end */
+bool time_write_try (void)
+{
+	if (time_seq & 0x01)
+	{
+		time_held = TRUE;
+		return FALSE;
+	}
+	
+	time_seq++;
+	return TRUE;
+}
+
+/* Both, requests PendSV when it gave up during the write of main loop */
+void time_write_end (void)
+{
+	time_seq++;
+	
+	if (time_held)
+	{
+		time_held = FALSE;
+		hal_pendsv_set();
+	}
+}
+
+/* Consistent copy of time (main loop) */
+void time_read (volatile time_t* time, time_t* copy)
+{
+	uint8_t seq;
+	
+	do
+	{
+		seq = time_seq;
+		*copy = *time;
+	} while (seq != time_seq);
 }
@@ -1,9 +1,8 @@
 #ifndef DRIVER_H
 #define DRIVER_H
 
-#define CORE_M0PLUS
-#include "chip.h"
-#include "system_LPC812.h"
+#include "hal.h"
+#include "board.h"
 
 
 typedef struct time {
@@ -37,84 +36,59 @@ typedef enum {
 } date_time;
 
 
-/* Nixie clock board constants */
+/* Nixie clock board constants, pin layout is described in board.h */
+#define SW1 BOARD_SW1
+#define SW2 BOARD_SW2
+#define TX_PIN BOARD_TX_PIN
+#define RX_PIN BOARD_RX_PIN
 
-/* Oscillator setting - data needed for LPC8xx Clock Driver functions of LPCOpen*/
-/**
- * @brief	System oscillator rate
- * This value is defined externally to the chip layer and contains
- * the value in Hz for the external oscillator for the board. If using the
- * internal oscillator, this rate can be 0.
- */
-//extern const uint32_t OscRateIn = 18432000ul;
-
-/**
- * @brief	Clock rate on the CLKIN pin
- * This value is defined externally to the chip layer and contains
- * the value in Hz for the CLKIN pin for the board. If this pin isn't used,
- * this rate can be 0.
- */
-//extern const uint32_t ExtRateIn = 0;
-
-/* --------------------------- */
-
-/* I/O port pin layout definition */
-#define SEC 					13
-#define SEC_TENS 			17
+#define	TIME	0
+#define	DATE	1
+#define USER_DATA 2
+#define STREAM_DATA 3 /* frames streamed over UART, no transitions and no timeout */
+#define	LOCK 	0x80
 
-#define MINUT 				15
-#define MINUT_TENS 		1
+#define TIME_ONLY 0x80
 
-#define HOUR					7
-#define HOUR_TENS 		14
+#define FIRST_YEAR 2000 /* only two year digits are displayed */
+#define LAST_YEAR 2099
 
-#define SW1						12
-#define SW2						5
+extern const uint8_t anode_pin[BOARD_TUBES];
 
-#ifdef BOARD_REV1
-	#define TX_PIN				0
-	#define RX_PIN				6
+/* Clock time (seconds, minutes, hours) is binary by default. With BCD_TIME defined it is counted
+in packed BCD, displayed digits need no conversion and binary values (UART, set mode editing)
+come from lookup tables. Date is binary in both cases */
+#ifdef BCD_TIME
+	#define TIME_TO_BIN(field) (bcd_to_bin[(field)])
+	#define TIME_FROM_BIN(value) (bin_to_bcd[(value)])
+	#define TIME_DIGITS(field) (field)
+	extern const uint8_t bcd_to_bin[0x60];
+	extern const uint8_t bin_to_bcd[60];
 #else
-	#define TX_PIN				6
-	#define RX_PIN				0
+	#define TIME_TO_BIN(field) (field)
+	#define TIME_FROM_BIN(value) (value)
+	#define TIME_DIGITS(field) to_BCD(field)
 #endif
 
-#ifdef BOARD_REV1
-	#define BCD_A				16
-	#define BCD_B				11
-	#define BCD_C				4
-	#define BCD_D				10
-#else
-	#define BCD_A				4
-	#define BCD_B				16
-	#define BCD_C				10
-	#define BCD_D				11
-#endif
+/* Writes of clock time are counted (seqlock), the count is odd while main loop writes */
+extern volatile uint8_t time_seq;
 
-/* ----------------------------- */
-
-#define OUT_PORT_MASK 0x3EC92 /* pins 1, 4, 7, 10, 11, 13, 14, 15, 16 and 17 */
-#define IN_PORT_MASK (1 << SW1) | (1 << SW2)
-
-
-#define	TIME	0
-#define	DATE	1
-#define USER_DATA 2
-#define	LOCK 	0x80
-
-#define TIME_ONLY 0x80
+/* Set by every change of time, date, user data or set mode, displayed digits are recomputed
+only then (main loop out of set mode, PendSV in set mode) */
+extern volatile bool display_dirty;
 
 /* Functions definitions */
-void setupMRT(uint8_t ch, MRT_MODE_T mode, uint32_t rate);
 void set_number (uint8_t number);
-void work_around_7442_4028 (uint8_t* number);
-uint32_t SysTick_Config_half(uint32_t ticks);
 void board_init (void);
 void time_inc_dec (volatile time_t* time, int8_t dec_inc_value, date_time what);
-void roll_numbers(volatile time_t* time, volatile display_t* user_data, volatile display_t *display);
+void field_inc_dec (volatile time_t* time, int8_t dec_inc_value, date_time what);
+int16_t wrap_value (int16_t value, int16_t min, int16_t max);
 uint8_t to_BCD (uint8_t number);
-bool roll(volatile uint8_t* displayed, uint8_t needed, uint8_t over);
 uint8_t year_to_number (uint16_t year);
 uint8_t days_in_month (uint8_t month, uint16_t year);
+void time_write_begin (void);
+bool time_write_try (void);
+void time_write_end (void);
+void time_read (volatile time_t* time, time_t* copy);
 
 #endif /* DRIVER_H */
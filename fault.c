@@ -0,0 +1,153 @@
+#include "fault.h"
+#include "trace.h"
+
+#define EXCEPTION_FRAME_SIZE 32 /* r0-r3, r12, lr, pc, xPSR */
+#define XPSR_ALIGNED 0x200 /* frame was aligned to 8 bytes by extra word */
+#define XPSR_EXCEPTION 0x3F
+
+static HAL_NOINIT fault_record_t record;
+
+#ifndef HOST_BUILD
+void HardFault_Handler (void);
+#endif
+
+
+/* Start branch trace, record of previous fault stays for reading */
+void fault_init (void)
+{
+	if (record.valid != FAULT_VALID)
+	{
+		fault_clear();
+	}
+	
+	hal_branch_trace_init();
+}
+
+/* Called by HardFault_Handler with the exception frame, does not return.
+Used attribute keeps it with LTO, the only call is from assembler */
+__attribute__((used)) void fault_capture (const uint32_t* frame)
+{
+	uint32_t branches[HAL_BRANCH_TRACE_SIZE * 2];
+	uint8_t count;
+	uint8_t end;
+	uint8_t i;
+	uint32_t head;
+	volatile trace_record_t* trace;
+	
+	/* first, branches of this handler would push out the ones before the fault */
+	count = hal_branch_trace_read(branches);
+	
+	record.r0 = frame[0];
+	record.r1 = frame[1];
+	record.r2 = frame[2];
+	record.r3 = frame[3];
+	record.r12 = frame[4];
+	record.lr = frame[5];
+	record.pc = frame[6];
+	record.xpsr = frame[7];
+	record.sp = (uint32_t)(uintptr_t)frame + EXCEPTION_FRAME_SIZE + ((frame[7] & XPSR_ALIGNED) ? 4 : 0);
+	record.exception = frame[7] & XPSR_EXCEPTION;
+	
+	/* the branch to this handler is the newest one kept */
+	end = count;
+#ifndef HOST_BUILD
+	while ((end > 0) && ((branches[end * 2 - 1] & ~1ul) != ((uint32_t)HardFault_Handler & ~1ul)))
+	{
+		end--;
+	}
+	if (end == 0)
+	{
+		end = count;
+	}
+#endif
+	for (i = 0; i < FAULT_BRANCHES * 2; i++)
+	{
+		record.branches[i] = 0;
+	}
+	for (i = 0; (i < FAULT_BRANCHES) && (i < end); i++)
+	{
+		record.branches[(FAULT_BRANCHES - 1 - i) * 2] = branches[(end - 1 - i) * 2];
+		record.branches[(FAULT_BRANCHES - 1 - i) * 2 + 1] = branches[(end - 1 - i) * 2 + 1];
+	}
+	
+	head = trace_buffer.head;
+	for (i = 0; i < FAULT_TRACES; i++)
+	{
+		if (head > i)
+		{
+			trace = &trace_buffer.records[(head - 1 - i) & (TRACE_SIZE - 1)];
+			record.traces[i * 2] = trace->time;
+			record.traces[i * 2 + 1] = trace->event | (trace->data << 8);
+		}
+		else
+		{
+			record.traces[i * 2] = 0;
+			record.traces[i * 2 + 1] = TR_NONE;
+		}
+	}
+	
+	record.valid = FAULT_VALID;
+	hal_system_reset();
+}
+
+/* Word of fault_record_t, FALSE if index is out of the record */
+bool fault_word (uint8_t index, uint32_t* value)
+{
+	if (index >= FAULT_WORDS)
+	{
+		return FALSE;
+	}
+	
+	*value = ((const uint32_t*)&record)[index];
+	return TRUE;
+}
+
+void fault_clear (void)
+{
+	uint8_t i;
+	
+	for (i = 0; i < FAULT_WORDS; i++)
+	{
+		((uint32_t*)&record)[i] = 0;
+	}
+}
+
+#ifndef HOST_BUILD
+/* Stack pointer of the exception frame (main or process stack by bit 2 of EXC_RETURN)
+goes to fault_capture, no register is pushed before */
+#if defined(__ARMCC_VERSION)
+__asm void HardFault_Handler (void)
+{
+	IMPORT fault_capture
+	MOVS R0, #4
+	MOV R1, LR
+	TST R0, R1
+	BEQ main_stack
+	MRS R0, PSP
+	B capture
+main_stack
+	MRS R0, MSP
+capture
+	LDR R1, =fault_capture
+	BX R1
+}
+#else
+__attribute__((naked)) void HardFault_Handler (void)
+{
+	__asm volatile (
+		"movs r0, #4\n"
+		"mov r1, lr\n"
+		"tst r0, r1\n"
+		"beq 1f\n"
+		"mrs r0, psp\n"
+		"b 2f\n"
+		"1:\n"
+		"mrs r0, msp\n"
+		"2:\n"
+		"ldr r1, =fault_capture\n"
+		"bx r1\n"
+		".ltorg\n"
+	);
+}
+#endif
+#endif /* HOST_BUILD */
@@ -0,0 +1,38 @@
+#ifndef FAULT_H
+#define FAULT_H
+
+/* HardFault post-mortem. HardFault_Handler saves registers stacked by the exception, the
+exception which was active, the last branches of Micro Trace Buffer and the last trace records
+into RAM which is not initialized at reset, then resets the chip. After the reset the record
+is read over UART (GET|FAULT) word by word, in order of fault_record_t */
+
+#include "hal.h"
+
+#define FAULT_VALID 0x4641554C /* "FAUL", word 0 of record when a fault was captured */
+#define FAULT_BRANCHES 4 /* branches before the fault, source and destination */
+#define FAULT_TRACES 4 /* the newest records of trace.c, time and event | data << 8 */
+
+typedef struct fault_record {
+	uint32_t valid;
+	uint32_t r0;
+	uint32_t r1;
+	uint32_t r2;
+	uint32_t r3;
+	uint32_t r12;
+	uint32_t lr;
+	uint32_t pc; /* faulting instruction */
+	uint32_t xpsr;
+	uint32_t sp; /* stack pointer before the exception frame */
+	uint32_t exception; /* exception number active at the fault, 0 = main loop, 16+ = IRQ */
+	uint32_t branches[FAULT_BRANCHES * 2]; /* the oldest first, 0 if not recorded */
+	uint32_t traces[FAULT_TRACES * 2]; /* the newest first */
+} fault_record_t;
+
+#define FAULT_WORDS (sizeof(fault_record_t) / sizeof(uint32_t))
+
+void fault_init (void);
+void fault_capture (const uint32_t* frame);
+bool fault_word (uint8_t index, uint32_t* value);
+void fault_clear (void);
+
+#endif /* FAULT_H */
@@ -0,0 +1,18 @@
+# Toolchain file for GNU Arm Embedded (arm-none-eabi-gcc), tools must be in PATH
+set(CMAKE_SYSTEM_NAME Generic)
+set(CMAKE_SYSTEM_PROCESSOR arm)
+
+set(CMAKE_C_COMPILER arm-none-eabi-gcc)
+set(CMAKE_ASM_COMPILER arm-none-eabi-gcc)
+# wrappers with LTO plugin, plain ar would drop LTO objects of the chip library
+set(CMAKE_AR arm-none-eabi-gcc-ar)
+set(CMAKE_RANLIB arm-none-eabi-gcc-ranlib)
+set(CMAKE_SIZE arm-none-eabi-size)
+set(CMAKE_NM_TOOL arm-none-eabi-nm)
+set(CMAKE_OBJCOPY arm-none-eabi-objcopy)
+
+# no host libraries, test programs are only compiled into static library
+set(CMAKE_TRY_COMPILE_TARGET_TYPE STATIC_LIBRARY)
+set(CMAKE_FIND_ROOT_PATH_MODE_PROGRAM NEVER)
+set(CMAKE_FIND_ROOT_PATH_MODE_LIBRARY ONLY)
+set(CMAKE_FIND_ROOT_PATH_MODE_INCLUDE ONLY)
@@ -0,0 +1,73 @@
+# Size report of one firmware build, run after link:
+#   cmake -DELF=<file> -DSIZE=<size> -DNM=<nm> -DFLASH_SIZE=<bytes> -DRAM_SIZE=<bytes>
+#         -DSTACK_SIZE=<bytes> -DHEAP_SIZE=<bytes> -P size_report.cmake
+# Writes <ELF>.size.txt with usage of flash and RAM and list of symbols by size,
+# fails (and deletes ELF so the next build links again) when the budget is exceeded.
+
+execute_process(COMMAND ${SIZE} -A -d ${ELF} OUTPUT_VARIABLE sections RESULT_VARIABLE result)
+if(result)
+	message(FATAL_ERROR "${SIZE} failed on ${ELF}")
+endif()
+
+set(text 0)
+set(data 0)
+set(bss 0)
+set(ramfunc 0)
+set(ram_vectors 0)
+set(noinit 0)
+string(REPLACE "\n" ";" sections "${sections}")
+foreach(line ${sections})
+	if(line MATCHES "^\\.(text|ARM\\.exidx|rodata)[ \t]+([0-9]+)")
+		math(EXPR text "${text} + ${CMAKE_MATCH_2}")
+	elseif(line MATCHES "^\\.data[ \t]+([0-9]+)")
+		math(EXPR data "${data} + ${CMAKE_MATCH_1}")
+	elseif(line MATCHES "^\\.bss[ \t]+([0-9]+)")
+		math(EXPR bss "${bss} + ${CMAKE_MATCH_1}")
+	elseif(line MATCHES "^\\.ramfunc[ \t]+([0-9]+)")
+		math(EXPR ramfunc "${ramfunc} + ${CMAKE_MATCH_1}")
+	elseif(line MATCHES "^\\.ram_vectors[ \t]+([0-9]+)")
+		math(EXPR ram_vectors "${ram_vectors} + ${CMAKE_MATCH_1}")
+	elseif(line MATCHES "^\\.noinit[ \t]+([0-9]+)")
+		math(EXPR noinit "${noinit} + ${CMAKE_MATCH_1}")
+	endif()
+endforeach()
+
+# stack and heap are reserved by linker script, the rest is the budget of the application;
+# code executed from RAM (RAM_ISR) takes both, its copy is loaded from flash as .data;
+# records kept across reset (.noinit) take RAM only
+math(EXPR flash_used "${text} + ${data} + ${ramfunc}")
+math(EXPR ram_used "${data} + ${bss} + ${noinit} + ${ramfunc} + ${ram_vectors}")
+math(EXPR ram_budget "${RAM_SIZE} - ${STACK_SIZE} - ${HEAP_SIZE}")
+math(EXPR flash_free "${FLASH_SIZE} - ${flash_used}")
+math(EXPR ram_free "${ram_budget} - ${ram_used}")
+
+set(summary "flash ${flash_used} of ${FLASH_SIZE} B (${flash_free} free), RAM ${ram_used} of ${ram_budget} B (${ram_free} free, ${noinit} B kept across reset, stack ${STACK_SIZE} B and heap ${HEAP_SIZE} B reserved)")
+if(ramfunc OR ram_vectors)
+	string(APPEND summary ", in RAM code ${ramfunc} B and vectors ${ram_vectors} B")
+endif()
+
+execute_process(COMMAND ${NM} --print-size --size-sort --reverse-sort --radix=d ${ELF} OUTPUT_VARIABLE symbols)
+set(flash_symbols "")
+set(ram_symbols "")
+string(REPLACE "\n" ";" symbols "${symbols}")
+foreach(line ${symbols})
+	if(line MATCHES "^[0-9]+ ([0-9]+) ([A-Za-z]) (.+)$")
+		math(EXPR bytes "${CMAKE_MATCH_1}")
+		set(type ${CMAKE_MATCH_2})
+		set(entry "  ${bytes}\t${CMAKE_MATCH_3}\n")
+		if(type MATCHES "[TtRrWw]")
+			string(APPEND flash_symbols "${entry}")
+		elseif(type MATCHES "[DdBbVv]")
+			string(APPEND ram_symbols "${entry}")
+		endif()
+	endif()
+endforeach()
+
+get_filename_component(name ${ELF} NAME)
+file(WRITE ${ELF}.size.txt "${name}: ${summary}\n\nFlash symbols (bytes):\n${flash_symbols}\nRAM symbols (bytes):\n${ram_symbols}")
+message(STATUS "${name}: ${summary}")
+
+if(flash_free LESS 0 OR ram_free LESS 0)
+	file(REMOVE ${ELF})
+	message(FATAL_ERROR "${name} exceeds the memory budget, see ${ELF}.size.txt")
+endif()
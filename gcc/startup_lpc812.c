@@ -0,0 +1,155 @@
+/* Startup of LPC812 for GCC build, the same vector table as startup_LPC8xx.s of Keil build.
+Checksum of vectors at 0x1C (needed by boot ROM) is filled in by the flashing tool as in Keil */
+
+#include <stdint.h>
+#include "system_LPC812.h"
+
+#define CRP_DISABLED 0xFFFFFFFF /* see Code Read Protection in startup_LPC8xx.s */
+#define STACK_PAINT 0xC5C5C5C5 /* HAL_STACK_PAINT of hal.h */
+
+/* Symbols of linker script lpc812_flash.ld */
+extern uint32_t __ramfunc_load__;
+extern uint32_t __ramfunc_start__;
+extern uint32_t __ramfunc_end__;
+extern uint32_t __data_load__;
+extern uint32_t __data_start__;
+extern uint32_t __data_end__;
+extern uint32_t __bss_start__;
+extern uint32_t __bss_end__;
+extern uint32_t __StackLimit;
+extern uint32_t __StackTop;
+
+int main (void);
+void Reset_Handler (void);
+void Default_Handler (void);
+
+/* Handlers not defined by application end in Default_Handler */
+void NMI_Handler (void) __attribute__ ((weak, alias("Default_Handler")));
+void HardFault_Handler (void) __attribute__ ((weak, alias("Default_Handler")));
+void SVC_Handler (void) __attribute__ ((weak, alias("Default_Handler")));
+void PendSV_Handler (void) __attribute__ ((weak, alias("Default_Handler")));
+void SysTick_Handler (void) __attribute__ ((weak, alias("Default_Handler")));
+void SPI0_IRQHandler (void) __attribute__ ((weak, alias("Default_Handler")));
+void SPI1_IRQHandler (void) __attribute__ ((weak, alias("Default_Handler")));
+void UART0_IRQHandler (void) __attribute__ ((weak, alias("Default_Handler")));
+void UART1_IRQHandler (void) __attribute__ ((weak, alias("Default_Handler")));
+void UART2_IRQHandler (void) __attribute__ ((weak, alias("Default_Handler")));
+void I2C_IRQHandler (void) __attribute__ ((weak, alias("Default_Handler")));
+void SCT_IRQHandler (void) __attribute__ ((weak, alias("Default_Handler")));
+void MRT_IRQHandler (void) __attribute__ ((weak, alias("Default_Handler")));
+void CMP_IRQHandler (void) __attribute__ ((weak, alias("Default_Handler")));
+void WDT_IRQHandler (void) __attribute__ ((weak, alias("Default_Handler")));
+void BOD_IRQHandler (void) __attribute__ ((weak, alias("Default_Handler")));
+void WKT_IRQHandler (void) __attribute__ ((weak, alias("Default_Handler")));
+void PININT0_IRQHandler (void) __attribute__ ((weak, alias("Default_Handler")));
+void PININT1_IRQHandler (void) __attribute__ ((weak, alias("Default_Handler")));
+void PININT2_IRQHandler (void) __attribute__ ((weak, alias("Default_Handler")));
+void PININT3_IRQHandler (void) __attribute__ ((weak, alias("Default_Handler")));
+void PININT4_IRQHandler (void) __attribute__ ((weak, alias("Default_Handler")));
+void PININT5_IRQHandler (void) __attribute__ ((weak, alias("Default_Handler")));
+void PININT6_IRQHandler (void) __attribute__ ((weak, alias("Default_Handler")));
+void PININT7_IRQHandler (void) __attribute__ ((weak, alias("Default_Handler")));
+
+/* Named as in startup_LPC8xx.s, SystemInit points VTOR to it */
+__attribute__ ((used, section(".isr_vector")))
+void (* const __Vectors[])(void) = {
+	(void (*)(void))&__StackTop,	/* Top of Stack */
+	Reset_Handler,
+	NMI_Handler,
+	HardFault_Handler,
+	0,
+	0,
+	0,
+	0,	/* checksum */
+	0,
+	0,
+	0,
+	SVC_Handler,
+	0,
+	0,
+	PendSV_Handler,
+	SysTick_Handler,
+
+	/* External Interrupts */
+	SPI0_IRQHandler,	/* 16+ 0 SPI0 */
+	SPI1_IRQHandler,	/* 16+ 1 SPI1 */
+	0,
+	UART0_IRQHandler,	/* 16+ 3 UART0 */
+	UART1_IRQHandler,	/* 16+ 4 UART1 */
+	UART2_IRQHandler,	/* 16+ 5 UART2 */
+	0,
+	0,
+	I2C_IRQHandler,		/* 16+ 8 I2C */
+	SCT_IRQHandler,		/* 16+ 9 State configurable timer */
+	MRT_IRQHandler,		/* 16+10 Multi-rate timer */
+	CMP_IRQHandler,		/* 16+11 Analog comparator */
+	WDT_IRQHandler,		/* 16+12 Windowed watchdog */
+	BOD_IRQHandler,		/* 16+13 BOD */
+	0,
+	WKT_IRQHandler,		/* 16+15 Self wake-up timer */
+	0,
+	0,
+	0,
+	0,
+	0,
+	0,
+	0,
+	0,
+	PININT0_IRQHandler,	/* 16+24 PIO INT0 */
+	PININT1_IRQHandler,	/* 16+25 PIO INT1 */
+	PININT2_IRQHandler,	/* 16+26 PIO INT2 */
+	PININT3_IRQHandler,	/* 16+27 PIO INT3 */
+	PININT4_IRQHandler,	/* 16+28 PIO INT4 */
+	PININT5_IRQHandler,	/* 16+29 PIO INT5 */
+	PININT6_IRQHandler,	/* 16+30 PIO INT6 */
+	PININT7_IRQHandler	/* 16+31 PIO INT7 */
+};
+
+__attribute__ ((used, section(".crp")))
+const uint32_t crp_word = CRP_DISABLED;
+
+/* Paint stack, initialize RAM and continue as Reset_Handler of Keil (SystemInit, main) */
+void Reset_Handler (void)
+{
+	uint32_t* src;
+	uint32_t* dst;
+	uint32_t* sp;
+
+	/* whole stack below own frame, stack.c finds the high-water mark */
+	__asm volatile ("mov %0, sp" : "=r" (sp));
+	for (dst = &__StackLimit; dst < sp; dst++)
+	{
+		*dst = STACK_PAINT;
+	}
+
+	src = &__ramfunc_load__;
+	dst = &__ramfunc_start__;
+	while (dst < &__ramfunc_end__)
+	{
+		*dst++ = *src++;
+	}
+	src = &__data_load__;
+	dst = &__data_start__;
+	while (dst < &__data_end__)
+	{
+		*dst++ = *src++;
+	}
+	for (dst = &__bss_start__; dst < &__bss_end__; dst++)
+	{
+		*dst = 0;
+	}
+
+	SystemInit();
+	main();
+
+	while (1)
+	{
+	}
+}
+
+void Default_Handler (void)
+{
+	while (1)
+	{
+	}
+}
@@ -0,0 +1,62 @@
+#ifndef HAL_H
+#define HAL_H
+
+/* Hardware abstraction layer - the only place where peripherals are accessed.
+On target (default) it maps to LPCOpen calls of LPC812, hot path functions
+(GPIO, timers, pin interrupts, NVIC and UART data) are always inlined register
+accesses in hal_lpc8xx.h. With HOST_BUILD defined
+the peripherals are emulated by hal_host.c and the clock logic can be built
+with GCC/Clang on a PC (see README.md) */
+
+#ifdef HOST_BUILD
+	#include "hal_host.h"
+#else
+	#include "hal_lpc8xx.h"
+#endif
+
+/* Pattern of unused stack words, written by startup code (hal_system_init on host) */
+#define HAL_STACK_PAINT 0xC5C5C5C5ul
+
+/* Initialization functions common for both implementations */
+
+/* System */
+void hal_system_init (void);
+uint32_t hal_systick_init (uint32_t ticks); /* ticks of SysTick clock (hal_systick_rate), returns 1 if impossible */
+uint32_t hal_systick_rate (void);
+void hal_timestamp_init (void); /* free-running counter of system clock cycles (hal_timestamp) */
+
+/* System clock is the crystal divided by divider (1 = full rate), call with interrupts disabled.
+The current second of SysTick and periods of running timers are rescaled to the new rate,
+reload values of timers too; users of hal_clock_rate recompute their intervals afterwards */
+void hal_clock_set_divider (uint8_t divider);
+
+/* Reset of the chip, host program only gets a request */
+void hal_system_reset (void);
+
+/* Micro Trace Buffer of Cortex-M0+ records the last HAL_BRANCH_TRACE_SIZE branches into RAM,
+read stops it and gives pairs of source and destination address, the oldest first */
+#define HAL_BRANCH_TRACE_SIZE 16
+void hal_branch_trace_init (void);
+uint8_t hal_branch_trace_read (uint32_t* entries); /* room for HAL_BRANCH_TRACE_SIZE pairs, returns count */
+
+/* Windowed watchdog, resets when not fed within timeout_ms or fed sooner than window_ms
+after the previous feed, warning before the reset is routed to NMI (NMI_Handler) */
+void hal_watchdog_init (uint32_t timeout_ms, uint32_t window_ms);
+bool hal_watchdog_reset_cause (void); /* the last reset was caused by watchdog, clears reset status */
+
+/* GPIO of port 0 */
+void hal_gpio_init (uint32_t out_mask, uint32_t in_mask);
+void hal_pins_init (uint8_t tx_pin, uint8_t rx_pin, uint32_t filtered_mask);
+
+/* Multi-rate timer, intervals are in ticks of hal_clock_rate */
+void hal_timer_init (void);
+
+/* Pin interrupts - pattern match engine */
+void hal_pinint_init (uint8_t channel, uint8_t pin);
+void hal_pinint_slice_src (uint8_t slice, uint8_t channel);
+void hal_pinint_enable_match (void);
+
+/* UART0, data are exchanged through LPCOpen ring buffers */
+void hal_uart_init (uint32_t baud_rate);
+
+#endif /* HAL_H */
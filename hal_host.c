@@ -0,0 +1,483 @@
+#include "hal.h"
+
+/* Host implementation of HAL - peripherals of LPC812 used by the clock emulated in memory */
+
+host_peripherals_t host_peripherals;
+
+static void gpio_update (uint32_t new_value);
+static void pinint_update (void);
+
+
+/* System */
+void hal_system_init (void)
+{
+	uint16_t i;
+	
+	/* as startup code of target */
+	for (i = 0; i < HOST_STACK_WORDS; i++)
+	{
+		host_peripherals.stack[i] = HAL_STACK_PAINT;
+	}
+	
+	/* system handler, cannot be disabled */
+	host_peripherals.irq_enabled[HAL_IRQ_PENDSV] = TRUE;
+	
+	host_peripherals.clock_divider = 1;
+}
+
+uint32_t hal_clock_rate (void)
+{
+	return HOST_CLOCK_RATE / host_peripherals.clock_divider;
+}
+
+uint32_t hal_systick_rate (void)
+{
+	return HOST_CLOCK_RATE / 2 / host_peripherals.clock_divider;
+}
+
+/* Host program keeps SysTick in virtual time, only its reload value follows the divider */
+void hal_clock_set_divider (uint8_t divider)
+{
+	host_timer_t* timer;
+	uint8_t ch;
+	
+	host_peripherals.systick_load = (host_peripherals.systick_load * host_peripherals.clock_divider) / divider;
+	
+	for (ch = 0; ch < HAL_TIMER_CHANNELS; ch++)
+	{
+		timer = &host_peripherals.timer[ch];
+		if (timer->running && (timer->mode == HAL_TIMER_REPEAT))
+		{
+			timer->value = (timer->value * host_peripherals.clock_divider) / divider;
+			timer->value = (timer->value > 0) ? timer->value : 1;
+			timer->interval = (timer->interval * host_peripherals.clock_divider) / divider;
+		}
+		else if (timer->running && (divider > host_peripherals.clock_divider))
+		{
+			/* one-shot count is only shortened, as by hal_lpc8xx.c */
+			timer->value = (timer->value * host_peripherals.clock_divider) / divider;
+			timer->value = (timer->value > 0) ? timer->value : 1;
+		}
+	}
+	
+	host_peripherals.clock_divider = divider;
+}
+
+uint32_t hal_systick_init (uint32_t ticks)
+{
+	host_peripherals.systick_load = ticks;
+	return 0;
+}
+
+uint32_t hal_systick_value (void)
+{
+	return host_peripherals.systick_value;
+}
+
+uint32_t hal_systick_reload (void)
+{
+	return host_peripherals.systick_load - 1;
+}
+
+void hal_timestamp_init (void)
+{
+	host_peripherals.timestamp = 0;
+}
+
+uint32_t hal_timestamp (void)
+{
+	return host_peripherals.timestamp;
+}
+
+/* Emulated stack is not used by host program, high-water mark stays 0 unless it writes there */
+uint32_t* hal_stack_bottom (void)
+{
+	return host_peripherals.stack;
+}
+
+uint32_t* hal_stack_top (void)
+{
+	return &host_peripherals.stack[HOST_STACK_WORDS];
+}
+
+void hal_system_reset (void)
+{
+	host_peripherals.reset_requested = TRUE;
+}
+
+/* No branch trace on host */
+void hal_branch_trace_init (void)
+{
+}
+
+uint8_t hal_branch_trace_read (uint32_t* entries)
+{
+	(void)entries;
+	return 0;
+}
+
+/* Windowed watchdog */
+void hal_watchdog_init (uint32_t timeout_ms, uint32_t window_ms)
+{
+	host_peripherals.watchdog_timeout = timeout_ms;
+	host_peripherals.watchdog_window = window_ms;
+	host_peripherals.watchdog_feeds = 0;
+}
+
+bool hal_watchdog_reset_cause (void)
+{
+	bool watchdog;
+	
+	watchdog = host_peripherals.watchdog_reset;
+	host_peripherals.watchdog_reset = FALSE;
+	
+	return watchdog;
+}
+
+void hal_watchdog_feed (void)
+{
+	host_peripherals.watchdog_feeds++;
+}
+
+void hal_watchdog_clear_warning (void)
+{
+}
+
+/* GPIO of port 0 */
+void hal_gpio_init (uint32_t out_mask, uint32_t in_mask)
+{
+	host_peripherals.gpio_dir = out_mask & ~in_mask;
+	gpio_update(0);
+}
+
+void hal_pins_init (uint8_t tx_pin, uint8_t rx_pin, uint32_t filtered_mask)
+{
+	/* pin multiplexing and glitch filters are not emulated */
+	(void)tx_pin;
+	(void)rx_pin;
+	(void)filtered_mask;
+}
+
+void hal_gpio_set (uint8_t pin)
+{
+	gpio_update(host_peripherals.gpio_out | (1UL << pin));
+}
+
+void hal_gpio_clear (uint8_t pin)
+{
+	gpio_update(host_peripherals.gpio_out & ~(1UL << pin));
+}
+
+void hal_gpio_set_mask (uint32_t mask)
+{
+	gpio_update(host_peripherals.gpio_out | mask);
+}
+
+void hal_gpio_clear_mask (uint32_t mask)
+{
+	gpio_update(host_peripherals.gpio_out & ~mask);
+}
+
+void hal_gpio_write (uint8_t pin, bool value)
+{
+	if (value)
+	{
+		hal_gpio_set(pin);
+	}
+	else
+	{
+		hal_gpio_clear(pin);
+	}
+}
+
+static void gpio_update (uint32_t new_value)
+{
+	uint32_t old_value = host_peripherals.gpio_out;
+
+	host_peripherals.gpio_out = new_value;
+	if ((old_value != new_value) && (host_peripherals.gpio_changed != NULL))
+	{
+		host_peripherals.gpio_changed(old_value, new_value);
+	}
+}
+
+/* Multi-rate timer */
+void hal_timer_init (void)
+{
+	uint8_t ch;
+
+	for (ch = 0; ch < HAL_TIMER_CHANNELS; ch++)
+	{
+		hal_timer_stop(ch);
+	}
+	host_peripherals.timer_pending = 0;
+
+	hal_irq_enable(HAL_IRQ_MRT);
+}
+
+void hal_timer_start (uint8_t ch, hal_timer_mode_t mode, uint32_t interval)
+{
+	host_peripherals.timer[ch].mode = mode;
+	host_peripherals.timer[ch].enabled = TRUE;
+	host_peripherals.timer_pending &= ~HAL_TIMER_FLAG(ch);
+	hal_timer_restart(ch, interval);
+}
+
+void hal_timer_stop (uint8_t ch)
+{
+	hal_timer_restart(ch, 0);
+	host_peripherals.timer[ch].enabled = FALSE;
+}
+
+/* as MRT, idle till the first restart */
+void hal_timer_config (uint8_t ch, hal_timer_mode_t mode)
+{
+	host_peripherals.timer[ch].mode = mode;
+	host_peripherals.timer[ch].enabled = TRUE;
+}
+
+void hal_timer_set_interval (uint8_t ch, uint32_t interval)
+{
+	host_peripherals.timer[ch].interval = interval;
+
+	/* as MRT, idle timer loads the interval immediately */
+	if (!host_peripherals.timer[ch].running)
+	{
+		hal_timer_restart(ch, interval);
+	}
+}
+
+void hal_timer_restart (uint8_t ch, uint32_t interval)
+{
+	host_peripherals.timer[ch].interval = interval;
+	host_peripherals.timer[ch].value = interval;
+	host_peripherals.timer[ch].running = (interval > 0);
+}
+
+uint32_t hal_timer_get_interval (uint8_t ch)
+{
+	return host_peripherals.timer[ch].interval;
+}
+
+uint32_t hal_timer_value (uint8_t ch)
+{
+	return host_peripherals.timer[ch].value;
+}
+
+bool hal_timer_running (uint8_t ch)
+{
+	return host_peripherals.timer[ch].running;
+}
+
+uint32_t hal_timer_pending (void)
+{
+	uint32_t int_pend = host_peripherals.timer_pending;
+
+	host_peripherals.timer_pending = 0;
+	host_peripherals.irq_pending[HAL_IRQ_MRT] = FALSE;
+
+	return int_pend;
+}
+
+/* Pin interrupts - pattern match engine */
+void hal_pinint_init (uint8_t channel, uint8_t pin)
+{
+	host_peripherals.pinint_pin[channel] = pin;
+}
+
+void hal_pinint_slice_src (uint8_t slice, uint8_t channel)
+{
+	host_peripherals.slice_src[slice] = channel;
+}
+
+void hal_pinint_enable_match (void)
+{
+	host_peripherals.match_enabled = TRUE;
+	pinint_update();
+}
+
+void hal_pinint_slice_set (uint8_t slice, hal_slice_cfg_t cfg, bool end_point)
+{
+	host_peripherals.slice_cfg[slice] = cfg;
+	host_peripherals.slice_end[slice] = end_point;
+	pinint_update();
+}
+
+hal_slice_cfg_t hal_pinint_slice_get (uint8_t slice)
+{
+	return host_peripherals.slice_cfg[slice];
+}
+
+void host_set_input (uint8_t pin, bool value)
+{
+	if (value)
+	{
+		host_peripherals.gpio_in |= (1UL << pin);
+	}
+	else
+	{
+		host_peripherals.gpio_in &= ~(1UL << pin);
+	}
+	pinint_update();
+}
+
+/* Evaluate product terms, interrupt of end point slice is requested when its term becomes true */
+static void pinint_update (void)
+{
+	static bool matched[HOST_SLICES];
+	bool term = TRUE;
+	bool level;
+	uint8_t slice;
+
+	if (!host_peripherals.match_enabled)
+	{
+		return;
+	}
+
+	for (slice = 0; slice < HOST_SLICES; slice++)
+	{
+		level = (host_peripherals.gpio_in >> host_peripherals.pinint_pin[host_peripherals.slice_src[slice]]) & 0x01;
+
+		switch (host_peripherals.slice_cfg[slice])
+		{
+			case HAL_SLICE_HIGH:
+				term = term && level;
+				break;
+			case HAL_SLICE_LOW:
+				term = term && !level;
+				break;
+			default:
+				term = FALSE;
+				break;
+		}
+
+		if (host_peripherals.slice_end[slice])
+		{
+			if (term && !matched[slice] && (slice <= (HAL_IRQ_PININT3 - HAL_IRQ_PININT0)))
+			{
+				host_peripherals.irq_pending[HAL_IRQ_PININT0 + slice] = TRUE;
+			}
+			matched[slice] = term;
+			term = TRUE; /* next product term */
+		}
+	}
+}
+
+/* NVIC */
+void hal_irq_enable (hal_irq_t irq)
+{
+	host_peripherals.irq_enabled[irq] = TRUE;
+}
+
+void hal_irq_disable (hal_irq_t irq)
+{
+	host_peripherals.irq_enabled[irq] = FALSE;
+}
+
+void hal_irq_clear_pending (hal_irq_t irq)
+{
+	host_peripherals.irq_pending[irq] = FALSE;
+}
+
+void hal_irq_set_priority (hal_irq_t irq, uint8_t priority)
+{
+	host_peripherals.irq_priority[irq] = priority;
+}
+
+void hal_pendsv_set (void)
+{
+	host_peripherals.irq_pending[HAL_IRQ_PENDSV] = TRUE;
+}
+
+/* interrupts are dispatched by host program between calls, nothing to lock */
+uint32_t hal_irq_save (void)
+{
+	return 0;
+}
+
+void hal_irq_restore (uint32_t irq_state)
+{
+	(void)irq_state;
+}
+
+/* UART0 */
+void hal_uart_init (uint32_t baud_rate)
+{
+	host_peripherals.uart_baud_rate = baud_rate;
+	host_peripherals.uart_rx_head = 0;
+	host_peripherals.uart_rx_tail = 0;
+	hal_uart_rx_irq_enable();
+	hal_irq_enable(HAL_IRQ_UART0);
+}
+
+bool hal_uart_rx_ready (void)
+{
+	return host_peripherals.uart_rx_head != host_peripherals.uart_rx_tail;
+}
+
+void hal_uart_rx_irq_enable (void)
+{
+	host_peripherals.uart_rx_irq = TRUE;
+	if (hal_uart_rx_ready())
+	{
+		host_peripherals.irq_pending[HAL_IRQ_UART0] = TRUE;
+	}
+}
+
+void hal_uart_rx_irq_disable (void)
+{
+	host_peripherals.uart_rx_irq = FALSE;
+}
+
+void hal_uart_irq_handler (RINGBUFF_T* rx_ring, RINGBUFF_T* tx_ring)
+{
+	uint8_t data;
+
+	(void)tx_ring; /* data are transmitted immediately by hal_uart_send */
+
+	while (hal_uart_rx_ready())
+	{
+		data = host_peripherals.uart_rx_fifo[host_peripherals.uart_rx_tail];
+		host_peripherals.uart_rx_tail = (host_peripherals.uart_rx_tail + 1) % HOST_UART_FIFO_SIZE;
+		RingBuffer_Insert(rx_ring, &data); /* data are lost if ring is full, as on target */
+	}
+	host_peripherals.irq_pending[HAL_IRQ_UART0] = FALSE;
+}
+
+uint32_t hal_uart_send (RINGBUFF_T* tx_ring, const void* data, int bytes)
+{
+	(void)tx_ring;
+
+	if (host_peripherals.uart_transmit != NULL)
+	{
+		host_peripherals.uart_transmit((const uint8_t*)data, bytes);
+	}
+
+	return bytes;
+}
+
+int hal_uart_read (RINGBUFF_T* rx_ring, void* data, int bytes)
+{
+	return RingBuffer_PopMult(rx_ring, data, bytes);
+}
+
+void host_uart_receive (const uint8_t* data, int bytes)
+{
+	uint8_t next;
+
+	while (bytes-- > 0)
+	{
+		next = (host_peripherals.uart_rx_head + 1) % HOST_UART_FIFO_SIZE;
+		if (next == host_peripherals.uart_rx_tail)
+		{
+			break; /* overrun */
+		}
+		host_peripherals.uart_rx_fifo[host_peripherals.uart_rx_head] = *data++;
+		host_peripherals.uart_rx_head = next;
+	}
+
+	if (host_peripherals.uart_rx_irq && hal_uart_rx_ready())
+	{
+		host_peripherals.irq_pending[HAL_IRQ_UART0] = TRUE;
+	}
+}
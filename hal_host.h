@@ -0,0 +1,146 @@
+#ifndef HAL_HOST_H
+#define HAL_HOST_H
+
+/* Host (Linux) implementation of HAL, do not include directly, use hal.h.
+Peripherals are emulated in host_peripherals, nothing happens on its own -
+a host program (simulator, test) drives the emulated hardware and calls interrupt handlers */
+
+#include <stdint.h>
+#include "lpc_types.h"
+#include "ring_buffer.h"
+
+#define HOST_CLOCK_RATE 18432000ul /* same as crystal of the board */
+#define HOST_UART_FIFO_SIZE 64
+
+typedef enum {
+	HAL_TIMER_REPEAT,
+	HAL_TIMER_ONESHOT
+} hal_timer_mode_t;
+#define HAL_TIMER_CHANNELS 4
+#define HAL_TIMER_FLAG(ch) (1 << (ch))
+
+typedef enum {
+	HAL_SLICE_HIGH,
+	HAL_SLICE_LOW,
+	HAL_SLICE_CONST0
+} hal_slice_cfg_t;
+#define HOST_SLICES 8
+#define HOST_STACK_WORDS 256 /* 1 kB as reserved by LPC812_flash.scf */
+
+typedef enum {
+	HAL_IRQ_UART0,
+	HAL_IRQ_MRT,
+	HAL_IRQ_PININT0,
+	HAL_IRQ_PININT1,
+	HAL_IRQ_PININT2,
+	HAL_IRQ_PININT3,
+	HAL_IRQ_PENDSV,
+	HAL_IRQ_NUM /* Do not change */
+} hal_irq_t;
+#define HAL_IRQ_PRIORITIES 4 /* 0 is the highest */
+
+typedef struct host_timer {
+	uint32_t interval; /* reload value */
+	uint32_t value; /* remaining ticks */
+	hal_timer_mode_t mode;
+	bool enabled; /* interrupt enabled */
+	bool running;
+} host_timer_t;
+
+typedef struct host_peripherals {
+	uint32_t gpio_dir;
+	uint32_t gpio_out;
+	uint32_t gpio_in;
+	host_timer_t timer[HAL_TIMER_CHANNELS];
+	uint32_t timer_pending;
+	uint8_t clock_divider; /* of system clock, virtual time counts the crystal */
+	uint32_t systick_load;
+	uint32_t systick_value; /* not counted by simulator */
+	uint32_t timestamp; /* cycles, set by host program */
+	uint32_t stack[HOST_STACK_WORDS]; /* painted by hal_system_init, host program may write it */
+	uint32_t watchdog_timeout; /* ms, 0 = not running */
+	uint32_t watchdog_window; /* ms */
+	uint32_t watchdog_feeds; /* counted, host program checks timeout and window */
+	bool watchdog_reset; /* reset cause, set by host program */
+	bool reset_requested; /* by hal_system_reset */
+	uint8_t pinint_pin[HOST_SLICES]; /* pin of pin interrupt channel */
+	uint8_t slice_src[HOST_SLICES]; /* pin interrupt channel of bit slice */
+	hal_slice_cfg_t slice_cfg[HOST_SLICES];
+	bool slice_end[HOST_SLICES];
+	bool match_enabled;
+	bool irq_enabled[HAL_IRQ_NUM];
+	bool irq_pending[HAL_IRQ_NUM];
+	uint8_t irq_priority[HAL_IRQ_NUM]; /* host program dispatches by it */
+	uint32_t uart_baud_rate;
+	bool uart_rx_irq;
+	uint8_t uart_rx_fifo[HOST_UART_FIFO_SIZE];
+	uint8_t uart_rx_head;
+	uint8_t uart_rx_tail;
+	void (*gpio_changed)(uint32_t old_value, uint32_t new_value); /* optional hooks of host program */
+	void (*uart_transmit)(const uint8_t* data, int bytes);
+} host_peripherals_t;
+
+extern host_peripherals_t host_peripherals;
+
+/* System */
+uint32_t hal_clock_rate (void);
+uint32_t hal_systick_value (void);
+uint32_t hal_systick_reload (void);
+uint32_t hal_timestamp (void);
+uint32_t* hal_stack_bottom (void);
+uint32_t* hal_stack_top (void);
+
+/* Variables not initialized at reset, host program starts with zeroed memory (power-on) */
+#define HAL_NOINIT
+
+/* Code executed from RAM on target (RAM_ISR) */
+#define HAL_RAMFUNC
+
+/* Windowed watchdog */
+void hal_watchdog_feed (void);
+void hal_watchdog_clear_warning (void);
+
+/* GPIO of port 0 */
+void hal_gpio_set (uint8_t pin);
+void hal_gpio_clear (uint8_t pin);
+void hal_gpio_set_mask (uint32_t mask);
+void hal_gpio_clear_mask (uint32_t mask);
+void hal_gpio_write (uint8_t pin, bool value);
+
+/* Multi-rate timer */
+void hal_timer_start (uint8_t ch, hal_timer_mode_t mode, uint32_t interval);
+void hal_timer_stop (uint8_t ch);
+void hal_timer_config (uint8_t ch, hal_timer_mode_t mode);
+void hal_timer_set_interval (uint8_t ch, uint32_t interval);
+void hal_timer_restart (uint8_t ch, uint32_t interval);
+uint32_t hal_timer_get_interval (uint8_t ch);
+uint32_t hal_timer_value (uint8_t ch);
+bool hal_timer_running (uint8_t ch);
+uint32_t hal_timer_pending (void);
+
+/* Pin interrupts - pattern match engine */
+void hal_pinint_slice_set (uint8_t slice, hal_slice_cfg_t cfg, bool end_point);
+hal_slice_cfg_t hal_pinint_slice_get (uint8_t slice);
+
+/* NVIC */
+void hal_irq_enable (hal_irq_t irq);
+void hal_irq_disable (hal_irq_t irq);
+void hal_irq_clear_pending (hal_irq_t irq);
+void hal_irq_set_priority (hal_irq_t irq, uint8_t priority);
+void hal_pendsv_set (void);
+uint32_t hal_irq_save (void);
+void hal_irq_restore (uint32_t irq_state);
+
+/* UART0 */
+bool hal_uart_rx_ready (void);
+void hal_uart_rx_irq_enable (void);
+void hal_uart_rx_irq_disable (void);
+void hal_uart_irq_handler (RINGBUFF_T* rx_ring, RINGBUFF_T* tx_ring);
+uint32_t hal_uart_send (RINGBUFF_T* tx_ring, const void* data, int bytes);
+int hal_uart_read (RINGBUFF_T* rx_ring, void* data, int bytes);
+
+/* Emulated hardware driven by host program */
+void host_uart_receive (const uint8_t* data, int bytes);
+void host_set_input (uint8_t pin, bool value);
+
+#endif /* HAL_HOST_H */
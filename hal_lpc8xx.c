@@ -0,0 +1,361 @@
+#include "hal.h"
+#include "system_LPC812.h"
+
+/* On target implementation of HAL initialization functions */
+
+/* Oscillator setting - data needed for LPC8xx Clock Driver functions of LPCOpen */
+/**
+ * @brief	System oscillator rate
+ * This value is defined externally to the chip layer and contains
+ * the value in Hz for the external oscillator for the board. If using the
+ * internal oscillator, this rate can be 0.
+ */
+const uint32_t OscRateIn = 18432000ul;
+
+/**
+ * @brief	Clock rate on the CLKIN pin
+ * This value is defined externally to the chip layer and contains
+ * the value in Hz for the CLKIN pin for the board. If this pin isn't used,
+ * this rate can be 0.
+ */
+const uint32_t ExtRateIn = 0;
+
+/* IOCON registers are not ordered by pin numbers, index is the pin number */
+static const CHIP_PINx_T iocon_pin[] = {
+	IOCON_PIO0, IOCON_PIO1, IOCON_PIO2, IOCON_PIO3, IOCON_PIO4, IOCON_PIO5,
+	IOCON_PIO6, IOCON_PIO7, IOCON_PIO8, IOCON_PIO9, IOCON_PIO10, IOCON_PIO11,
+	IOCON_PIO12, IOCON_PIO13, IOCON_PIO14, IOCON_PIO15, IOCON_PIO16, IOCON_PIO17
+};
+
+uint32_t hal_clock_hz;
+
+#if defined(RAM_ISR)
+/* Copy of vector table, VTOR needs it aligned to its size rounded up to power of 2 (256 B).
+Region of the scatter file and section of lpc812_flash.ld start at the beginning of RAM */
+#define VECTORS_NUM (16 + 32) /* system exceptions and interrupts of LPC812 */
+
+#if defined(__ARMCC_VERSION)
+static uint32_t ram_vectors[VECTORS_NUM] __attribute__((section(".ram_vectors"), zero_init, aligned(256)));
+#else
+static uint32_t ram_vectors[VECTORS_NUM] __attribute__((section(".ram_vectors"), aligned(256)));
+#endif
+
+static void ram_vectors_init (void);
+#endif
+
+void hal_system_init (void)
+{
+	/* Initialize system clock */
+	SystemInit();
+	Chip_Clock_EnablePeriphClock(SYSCTL_CLOCK_SWM);
+	
+	/* walks PLL and divider registers, hot paths use the captured value */
+	hal_clock_hz = Chip_Clock_GetSystemClockRate();
+	
+#if defined(RAM_ISR)
+	ram_vectors_init();
+#endif
+}
+
+#if defined(RAM_ISR)
+/* Vectors are fetched from RAM from now on, before any interrupt is enabled */
+static void ram_vectors_init (void)
+{
+	const uint32_t* flash_vectors = (const uint32_t*)SCB->VTOR; /* set by SystemInit */
+	uint8_t i;
+	
+	for (i = 0; i < VECTORS_NUM; i++)
+	{
+		ram_vectors[i] = flash_vectors[i];
+	}
+	
+	__DSB();
+	SCB->VTOR = (uint32_t)ram_vectors;
+	__DSB();
+	__ISB();
+}
+#endif
+
+static uint8_t clock_divider = 1;
+
+/* Remaining ticks of a one-shot channel below which it is left to expire by itself, more than
+the cycles from reading its counter to writing the new count */
+#define ONESHOT_MARGIN 64
+
+/* SysTick runs from system clock divided by 2 */
+uint32_t hal_systick_rate (void)
+{
+	return OscRateIn / 2 / clock_divider;
+}
+
+/* Counts are converted while the hardware runs, a few cycles per change are lost */
+void hal_clock_set_divider (uint8_t divider)
+{
+	uint32_t systick_left;
+	uint32_t systick_period;
+	uint32_t timer_now;
+	uint32_t timer_left;
+	uint32_t timer_period;
+	uint32_t status;
+	LPC_MRT_CH_T* channel;
+	uint8_t ch;
+	
+	systick_left = (SysTick->VAL * clock_divider) / divider;
+	systick_period = ((SysTick->LOAD + 1) * clock_divider) / divider;
+	
+	Chip_Clock_SetSysClockDiv(divider);
+	hal_clock_hz = Chip_Clock_GetSystemClockRate();
+	
+	/* the rest of the second from the written 0, reloaded at the next tick without
+	interrupt, then whole seconds (0 means the interrupt is already pending) */
+	if (systick_left > 1)
+	{
+		SysTick->LOAD = systick_left - 1;
+		SysTick->VAL = 0;
+		while (SysTick->VAL == 0)
+		{
+		}
+	}
+	SysTick->LOAD = systick_period - 1;
+	
+	/* MRT keeps counting with interrupts disabled and a non-zero INTVAL written to an idle
+	channel starts it again. Repeated channels never go idle: the period in progress continues
+	from the converted count, the next ones take the converted reload value (an expired one
+	keeps its flag and has reloaded by itself). One-shot channels may expire at any moment, their
+	count is only shortened (slower clock) and not touched near its end, one which expired
+	before the write and started again is stopped, its flag stays for the interrupt */
+	for (ch = 0; ch < MRT_CHANNELS_NUM; ch++)
+	{
+		channel = &LPC_MRT->CHANNEL[ch];
+		status = channel->STAT;
+		if (!(status & MRT_STAT_RUNNING))
+		{
+			continue;
+		}
+		
+		timer_now = channel->TIMER;
+		timer_left = (timer_now * clock_divider) / divider;
+		
+		if ((channel->CTRL & MRT_CTRL_MODE_MASK) == MRT_MODE_REPEAT)
+		{
+			timer_period = ((channel->INTVAL & ~MRT_INTVAL_LOAD) * clock_divider) / divider;
+			if (!(status & MRT_STAT_INTFLAG))
+			{
+				channel->INTVAL = ((timer_left > 0) ? timer_left : 1) | MRT_INTVAL_LOAD;
+			}
+			channel->INTVAL = timer_period;
+		}
+		else if (!(status & MRT_STAT_INTFLAG) && (timer_left < timer_now) && (timer_now > ONESHOT_MARGIN))
+		{
+			channel->INTVAL = ((timer_left > 0) ? timer_left : 1) | MRT_INTVAL_LOAD;
+			if ((channel->STAT & (MRT_STAT_RUNNING | MRT_STAT_INTFLAG)) == (MRT_STAT_RUNNING | MRT_STAT_INTFLAG))
+			{
+				channel->INTVAL = 0 | MRT_INTVAL_LOAD;
+			}
+		}
+	}
+	
+	clock_divider = divider;
+}
+
+uint32_t hal_systick_init (uint32_t ticks)
+{
+  if ((ticks - 1UL) > SysTick_LOAD_RELOAD_Msk)
+  {
+    return (1UL);                                                   /* Reload value impossible */
+  }
+
+  SysTick->LOAD  = (uint32_t)(ticks - 1UL);                         /* set reload register */
+  NVIC_SetPriority (SysTick_IRQn, (1UL << __NVIC_PRIO_BITS) - 1UL); /* set Priority for Systick Interrupt */
+  SysTick->VAL   = 0UL;                                             /* Load the SysTick Counter Value */
+  SysTick->CTRL  = /*SysTick_CTRL_CLKSOURCE_Msk |*/
+                   SysTick_CTRL_TICKINT_Msk   |
+                   SysTick_CTRL_ENABLE_Msk;                         /* Enable SysTick IRQ and SysTick Timer */
+  return (0UL);                                                     /* Function successful */
+}
+
+/* SCT as unified 32-bit counter without limit, counts system clock cycles */
+void hal_timestamp_init (void)
+{
+	Chip_SCT_Init(LPC_SCT);
+	Chip_SCT_Config(LPC_SCT, SCT_CONFIG_32BIT_COUNTER | SCT_CONFIG_CLKMODE_BUSCLK);
+	Chip_SCT_ClearControl(LPC_SCT, SCT_CTRL_HALT_L);
+}
+
+void hal_system_reset (void)
+{
+	NVIC_SystemReset();
+}
+
+/* Micro Trace Buffer, its registers are not defined by LPCOpen. Buffer is aligned to its size,
+MASK gives the size as 2^(MASK + 4) bytes, 8 bytes per branch */
+#define MTB_POSITION (*(volatile uint32_t*)0x14000000)
+#define MTB_MASTER (*(volatile uint32_t*)0x14000004)
+#define MTB_FLOW (*(volatile uint32_t*)0x14000008)
+#define MTB_BASE (*(volatile uint32_t*)0x1400000C)
+#define MTB_MASTER_EN (1ul << 31)
+#define MTB_MASK 3 /* 16 branches */
+#define MTB_POSITION_WRAP 0x04
+
+static uint32_t branch_trace[HAL_BRANCH_TRACE_SIZE * 2] __attribute__((aligned(HAL_BRANCH_TRACE_SIZE * 8)));
+
+void hal_branch_trace_init (void)
+{
+	MTB_MASTER = 0;
+	MTB_FLOW = 0; /* no watermark, buffer wraps around */
+	MTB_POSITION = (uint32_t)branch_trace - MTB_BASE;
+	MTB_MASTER = MTB_MASTER_EN | MTB_MASK;
+}
+
+uint8_t hal_branch_trace_read (uint32_t* entries)
+{
+	uint32_t position;
+	uint8_t next;
+	uint8_t count;
+	uint8_t i;
+	
+	MTB_MASTER &= ~MTB_MASTER_EN;
+	position = MTB_POSITION;
+	
+	/* next entry to be written is the oldest one when the buffer wrapped */
+	next = ((position & ~0x7ul) - ((uint32_t)branch_trace - MTB_BASE)) / 8;
+	next &= HAL_BRANCH_TRACE_SIZE - 1;
+	count = (position & MTB_POSITION_WRAP) ? HAL_BRANCH_TRACE_SIZE : next;
+	
+	for (i = 0; i < count; i++)
+	{
+		/* bit 0 of source and destination are flags of MTB */
+		entries[i * 2] = branch_trace[((next + HAL_BRANCH_TRACE_SIZE - count + i) & (HAL_BRANCH_TRACE_SIZE - 1)) * 2] & ~1ul;
+		entries[i * 2 + 1] = branch_trace[((next + HAL_BRANCH_TRACE_SIZE - count + i) & (HAL_BRANCH_TRACE_SIZE - 1)) * 2 + 1] & ~1ul;
+	}
+	
+	return count;
+}
+
+/* Watchdog oscillator 0.6 MHz / 64, WWDT divides it by 4, ticks of about 2.3 kHz (+-40 %) */
+void hal_watchdog_init (uint32_t timeout_ms, uint32_t window_ms)
+{
+	uint32_t rate;
+	uint32_t timeout;
+	uint32_t warning;
+	
+	Chip_Clock_SetWDTOSC(WDTLFO_OSC_0_60, 64);
+	Chip_SYSCTL_PowerUp(SYSCTL_SLPWAKE_WDTOSC_PD);
+	rate = Chip_Clock_GetWDTOSCRate() / 4;
+	
+	timeout = (rate * timeout_ms) / 1000;
+	warning = timeout / 4;
+	if (warning > 1023) /* 10-bit WARNINT */
+	{
+		warning = 1023;
+	}
+	
+	Chip_WWDT_Init(LPC_WWDT);
+	Chip_WWDT_SetTimeOut(LPC_WWDT, timeout);
+	Chip_WWDT_SetWarning(LPC_WWDT, warning);
+	Chip_WWDT_SetWindow(LPC_WWDT, timeout - (rate * window_ms) / 1000);
+	Chip_WWDT_SetOption(LPC_WWDT, WWDT_WDMOD_WDRESET);
+	Chip_WWDT_ClearStatusFlag(LPC_WWDT, WWDT_WDMOD_WDTOF | WWDT_WDMOD_WDINT);
+	
+	/* Warning interrupt as NMI, it is not blocked by stuck handler or disabled interrupts */
+	Chip_SYSCTL_SetNMISource(WDT_IRQn);
+	Chip_SYSCTL_EnableNMISource();
+	
+	Chip_WWDT_Start(LPC_WWDT);
+}
+
+bool hal_watchdog_reset_cause (void)
+{
+	uint32_t status;
+	
+	status = Chip_SYSCTL_GetSystemRSTStatus();
+	Chip_SYSCTL_ClearSystemRSTStatus(status);
+	
+	return (status & SYSCTL_RST_WDT) != 0;
+}
+
+void hal_gpio_init (uint32_t out_mask, uint32_t in_mask)
+{
+	Chip_GPIO_SetPortDIROutput(LPC_GPIO_PORT, 0, out_mask);
+	Chip_GPIO_SetPortDIRInput(LPC_GPIO_PORT, 0, in_mask);
+	
+	/* Set GPIO port mask value to make sure only output pins
+	are active during state change */
+	Chip_GPIO_SetPortMask(LPC_GPIO_PORT, 0, ~out_mask);
+	
+	/* Set all out pins to 0 */
+	Chip_GPIO_SetMaskedPortValue(LPC_GPIO_PORT, 0, 0);
+}
+
+void hal_pins_init (uint8_t tx_pin, uint8_t rx_pin, uint32_t filtered_mask)
+{
+	uint8_t pin;
+	
+	/* Connect the UART TX/RX signals to port pins */
+	Chip_SWM_DisableFixedPin(SWM_FIXED_ACMP_I1);
+	Chip_SWM_MovablePinAssign(SWM_U0_TXD_O, tx_pin);
+	Chip_SWM_MovablePinAssign(SWM_U0_RXD_I, rx_pin);
+	
+	/* Set Glitch filter for switches */
+	Chip_Clock_SetIOCONCLKDIV(IOCONCLKDIV1, 250);
+	for (pin = 0; pin < sizeof(iocon_pin) / sizeof(iocon_pin[0]); pin++)
+	{
+		if (filtered_mask & (1 << pin))
+		{
+			Chip_IOCON_PinSetSampleMode(LPC_IOCON, iocon_pin[pin], PIN_SMODE_CYC3);
+			Chip_IOCON_PinSetClockDivisor(LPC_IOCON, iocon_pin[pin], IOCONCLKDIV1);
+		}
+	}
+	
+	/* Disable !RESET pin */
+	Chip_SWM_DisableFixedPin(SWM_FIXED_RST);
+}
+
+void hal_timer_init (void)
+{
+	uint8_t mrtch;
+	
+	/* MRT Initialization and disable all timers */
+	Chip_MRT_Init();
+	for (mrtch = 0; mrtch < MRT_CHANNELS_NUM; mrtch++) {
+		Chip_MRT_SetDisabled(Chip_MRT_GetRegPtr(mrtch));
+	}
+	
+	/* Enable the interrupt for the MRT */
+	NVIC_EnableIRQ(MRT_IRQn);
+}
+
+/* Configure interrupt channel for the GPIO pin in SysCon block */
+void hal_pinint_init (uint8_t channel, uint8_t pin)
+{
+	Chip_SYSCTL_SetPinInterrupt(channel, pin);
+}
+
+void hal_pinint_slice_src (uint8_t slice, uint8_t channel)
+{
+	Chip_PININT_SetPatternMatchSrc(LPC_PININT, channel, (Chip_PININT_BITSLICE_T)slice);
+}
+
+void hal_pinint_enable_match (void)
+{
+	Chip_PININT_EnablePatternMatch(LPC_PININT);
+}
+
+void hal_uart_init (uint32_t baud_rate)
+{
+	Chip_Clock_SetUARTClockDiv(1);
+	
+	/* Setup UART */
+	Chip_UART_Init(LPC_USART0);
+	Chip_UART_ConfigData(LPC_USART0, UART_CFG_DATALEN_8 | UART_CFG_PARITY_NONE | UART_CFG_STOPLEN_1 );
+	Chip_Clock_SetUSARTNBaseClockRate((baud_rate * 16), true);
+	Chip_UART_SetBaud(LPC_USART0, baud_rate);
+	Chip_UART_Enable(LPC_USART0);
+	Chip_UART_TXEnable(LPC_USART0);
+	
+	/* Enable receive data and line status interrupt */
+	Chip_UART_IntEnable(LPC_USART0, UART_INTEN_RXRDY);
+	Chip_UART_IntDisable(LPC_USART0, UART_INTEN_TXRDY);	/* May not be needed */
+	
+	NVIC_EnableIRQ(UART0_IRQn);
+}
@@ -0,0 +1,306 @@
+#ifndef HAL_LPC8XX_H
+#define HAL_LPC8XX_H
+
+/* On target implementation of hot path HAL functions, do not include directly, use hal.h.
+Functions used by interrupt handlers access GPIO, MRT, PININT and USART registers directly and are
+always inlined, so a handler compiles to loads and stores without calls into LPCOpen. Clock rate
+is read from SYSCON once by hal_system_init */
+
+#define CORE_M0PLUS
+#include "chip.h"
+
+/* inlined even when the compiler would not (-O0, -Os with more callers) */
+#define HAL_INLINE STATIC INLINE __attribute__((always_inline))
+
+typedef MRT_MODE_T hal_timer_mode_t;
+#define HAL_TIMER_REPEAT MRT_MODE_REPEAT
+#define HAL_TIMER_ONESHOT MRT_MODE_ONESHOT
+#define HAL_TIMER_CHANNELS MRT_CHANNELS_NUM
+#define HAL_TIMER_FLAG(ch) MRTn_INTFLAG(ch)
+
+typedef Chip_PININT_BITSLICE_CFG_T hal_slice_cfg_t;
+#define HAL_SLICE_HIGH PININT_PATTERNHIGH
+#define HAL_SLICE_LOW PININT_PATTERNLOW
+#define HAL_SLICE_CONST0 PININT_PATTERCONST0
+
+typedef IRQn_Type hal_irq_t;
+#define HAL_IRQ_UART0 UART0_IRQn
+#define HAL_IRQ_MRT MRT_IRQn
+#define HAL_IRQ_PININT0 PININT0_IRQn
+#define HAL_IRQ_PININT1 PININT1_IRQn
+#define HAL_IRQ_PININT2 PININT2_IRQn
+#define HAL_IRQ_PININT3 PININT3_IRQn
+#define HAL_IRQ_PENDSV PendSV_IRQn
+#define HAL_IRQ_PRIORITIES (1 << __NVIC_PRIO_BITS) /* 0 is the highest */
+
+/* System clock in Hz, set by hal_system_init */
+extern uint32_t hal_clock_hz;
+
+HAL_INLINE uint32_t hal_clock_rate (void)
+{
+	return hal_clock_hz;
+}
+
+/* SysTick counter, counts down from reload value to 0 in ticks of hal_systick_rate */
+STATIC INLINE uint32_t hal_systick_value (void)
+{
+	return SysTick->VAL;
+}
+
+STATIC INLINE uint32_t hal_systick_reload (void)
+{
+	return SysTick->LOAD;
+}
+
+/* SCT counter running freely since hal_timestamp_init, wraps after 2^32 cycles */
+STATIC INLINE uint32_t hal_timestamp (void)
+{
+	return LPC_SCT->COUNT_U;
+}
+
+/* Stack region of linker (ARM_LIB_STACK of scatter file, .stack of lpc812_flash.ld),
+bottom is the lowest address, top is the initial stack pointer */
+#if defined(__ARMCC_VERSION)
+extern uint32_t Image$$ARM_LIB_STACK$$ZI$$Base[];
+extern uint32_t Image$$ARM_LIB_STACK$$ZI$$Limit[];
+#define HAL_STACK_BOTTOM Image$$ARM_LIB_STACK$$ZI$$Base
+#define HAL_STACK_TOP Image$$ARM_LIB_STACK$$ZI$$Limit
+#else
+extern uint32_t __StackLimit[];
+extern uint32_t __StackTop[];
+#define HAL_STACK_BOTTOM __StackLimit
+#define HAL_STACK_TOP __StackTop
+#endif
+
+STATIC INLINE uint32_t* hal_stack_bottom (void)
+{
+	return HAL_STACK_BOTTOM;
+}
+
+STATIC INLINE uint32_t* hal_stack_top (void)
+{
+	return HAL_STACK_TOP;
+}
+
+/* Variables not initialized at reset (scatter file region RW_m_noinit, .noinit of lpc812_flash.ld) */
+#if defined(__ARMCC_VERSION)
+#define HAL_NOINIT __attribute__((section(".noinit"), zero_init))
+#else
+#define HAL_NOINIT __attribute__((section(".noinit")))
+#endif
+
+/* Code executed from RAM without flash wait states, copied at startup by scatter loading
+(region RW_m_ramfunc) or Reset_Handler (.ramfunc of lpc812_flash.ld). Only with RAM_ISR defined,
+hal_system_init then moves the vector table to RAM as well */
+#if defined(RAM_ISR)
+#define HAL_RAMFUNC __attribute__((section(".ramfunc")))
+#else
+#define HAL_RAMFUNC
+#endif
+
+/* Windowed watchdog */
+STATIC INLINE void hal_watchdog_feed (void)
+{
+	Chip_WWDT_Feed(LPC_WWDT);
+}
+
+STATIC INLINE void hal_watchdog_clear_warning (void)
+{
+	Chip_WWDT_ClearStatusFlag(LPC_WWDT, WWDT_WDMOD_WDINT);
+}
+
+/* GPIO of port 0 */
+HAL_INLINE void hal_gpio_set (uint8_t pin)
+{
+	LPC_GPIO_PORT->SET[0] = 1UL << pin;
+}
+
+HAL_INLINE void hal_gpio_clear (uint8_t pin)
+{
+	LPC_GPIO_PORT->CLR[0] = 1UL << pin;
+}
+
+HAL_INLINE void hal_gpio_set_mask (uint32_t mask)
+{
+	LPC_GPIO_PORT->SET[0] = mask;
+}
+
+HAL_INLINE void hal_gpio_clear_mask (uint32_t mask)
+{
+	LPC_GPIO_PORT->CLR[0] = mask;
+}
+
+/* byte register of the pin, one store without read-modify-write */
+HAL_INLINE void hal_gpio_write (uint8_t pin, bool value)
+{
+	LPC_GPIO_PORT->B[0][pin] = value;
+}
+
+/* Multi-rate timer */
+HAL_INLINE void hal_timer_start (uint8_t ch, hal_timer_mode_t mode, uint32_t interval)
+{
+	LPC_MRT_CH_T* channel = &LPC_MRT->CHANNEL[ch];
+
+	channel->INTVAL = interval | MRT_INTVAL_LOAD;
+	
+	/* mode and interrupt enable in one write, then clear pending interrupt (write 1) */
+	channel->CTRL = (uint32_t)mode | MRT_CTRL_INTEN_MASK;
+	channel->STAT = MRT_STAT_INTFLAG;
+}
+
+HAL_INLINE void hal_timer_stop (uint8_t ch)
+{
+	LPC_MRT_CH_T* channel = &LPC_MRT->CHANNEL[ch];
+
+	channel->INTVAL = 0 | MRT_INTVAL_LOAD;
+	channel->CTRL &= ~MRT_CTRL_INTEN_MASK;
+}
+
+/* mode and interrupt enable in one write, timer stays idle till hal_timer_restart */
+HAL_INLINE void hal_timer_config (uint8_t ch, hal_timer_mode_t mode)
+{
+	LPC_MRT->CHANNEL[ch].CTRL = (uint32_t)mode | MRT_CTRL_INTEN_MASK;
+}
+
+/* new interval is used from the next period */
+HAL_INLINE void hal_timer_set_interval (uint8_t ch, uint32_t interval)
+{
+	LPC_MRT->CHANNEL[ch].INTVAL = interval;
+}
+
+/* new interval is used immediately, starts stopped one-shot timer */
+HAL_INLINE void hal_timer_restart (uint8_t ch, uint32_t interval)
+{
+	LPC_MRT->CHANNEL[ch].INTVAL = interval | MRT_INTVAL_LOAD;
+}
+
+HAL_INLINE uint32_t hal_timer_get_interval (uint8_t ch)
+{
+	return LPC_MRT->CHANNEL[ch].INTVAL & ~MRT_INTVAL_LOAD;
+}
+
+/* remaining ticks of current period, counts down */
+HAL_INLINE uint32_t hal_timer_value (uint8_t ch)
+{
+	return LPC_MRT->CHANNEL[ch].TIMER;
+}
+
+HAL_INLINE bool hal_timer_running (uint8_t ch)
+{
+	return (LPC_MRT->CHANNEL[ch].STAT & MRT_STAT_RUNNING) != 0;
+}
+
+/* returns and clears pending interrupts of all channels */
+HAL_INLINE uint32_t hal_timer_pending (void)
+{
+	uint32_t int_pend;
+
+	int_pend = LPC_MRT->IRQ_FLAG;
+	LPC_MRT->IRQ_FLAG = int_pend;
+
+	return int_pend;
+}
+
+/* Pin interrupts - pattern match engine. Configuration of slice and its end point bit are
+changed by one write, end point of slice 7 is fixed by hardware */
+HAL_INLINE void hal_pinint_slice_set (uint8_t slice, hal_slice_cfg_t cfg, bool end_point)
+{
+	uint32_t pmcfg_reg;
+	uint8_t shift = PININT_SRC_BITCFG_START + (slice * 3);
+
+	pmcfg_reg = LPC_PININT->PMCFG & ~((PININT_SRC_BITCFG_MASK << shift) | (1UL << slice));
+	pmcfg_reg |= (uint32_t)cfg << shift;
+	if (end_point && (slice < 7))
+	{
+		pmcfg_reg |= 1UL << slice;
+	}
+	LPC_PININT->PMCFG = pmcfg_reg;
+}
+
+HAL_INLINE hal_slice_cfg_t hal_pinint_slice_get (uint8_t slice)
+{
+	uint32_t pmcfg_reg;
+
+	pmcfg_reg = LPC_PININT->PMCFG & (PININT_SRC_BITCFG_MASK << (PININT_SRC_BITCFG_START + (slice * 3)));
+	pmcfg_reg = pmcfg_reg >> (PININT_SRC_BITCFG_START + (slice * 3));
+
+	return (hal_slice_cfg_t)pmcfg_reg;
+}
+
+/* NVIC */
+STATIC INLINE void hal_irq_enable (hal_irq_t irq)
+{
+	NVIC_EnableIRQ(irq);
+}
+
+STATIC INLINE void hal_irq_disable (hal_irq_t irq)
+{
+	NVIC_DisableIRQ(irq);
+}
+
+STATIC INLINE void hal_irq_clear_pending (hal_irq_t irq)
+{
+	NVIC_ClearPendingIRQ(irq);
+}
+
+/* works for PendSV and SysTick too */
+STATIC INLINE void hal_irq_set_priority (hal_irq_t irq, uint8_t priority)
+{
+	NVIC_SetPriority(irq, priority);
+}
+
+/* request PendSV_Handler, it runs when no handler of higher priority is active */
+STATIC INLINE void hal_pendsv_set (void)
+{
+	SCB->ICSR = SCB_ICSR_PENDSVSET_Msk;
+}
+
+/* disable all interrupts, returns previous state for hal_irq_restore (nesting is allowed) */
+STATIC INLINE uint32_t hal_irq_save (void)
+{
+	uint32_t primask;
+	
+	primask = __get_PRIMASK();
+	__disable_irq();
+	
+	return primask;
+}
+
+STATIC INLINE void hal_irq_restore (uint32_t irq_state)
+{
+	__set_PRIMASK(irq_state);
+}
+
+/* UART0, ring buffer transfers stay in LPCOpen, they run at byte rate */
+HAL_INLINE bool hal_uart_rx_ready (void)
+{
+	return (LPC_USART0->STAT & UART_STAT_RXRDY) != 0;
+}
+
+/* set and clear registers, no read-modify-write of INTENSET */
+HAL_INLINE void hal_uart_rx_irq_enable (void)
+{
+	LPC_USART0->INTENSET = UART_INTEN_RXRDY;
+}
+
+HAL_INLINE void hal_uart_rx_irq_disable (void)
+{
+	LPC_USART0->INTENCLR = UART_INTEN_RXRDY;
+}
+
+STATIC INLINE void hal_uart_irq_handler (RINGBUFF_T* rx_ring, RINGBUFF_T* tx_ring)
+{
+	Chip_UART_IRQRBHandler(LPC_USART0, rx_ring, tx_ring);
+}
+
+STATIC INLINE uint32_t hal_uart_send (RINGBUFF_T* tx_ring, const void* data, int bytes)
+{
+	return Chip_UART_SendRB(LPC_USART0, tx_ring, data, bytes);
+}
+
+STATIC INLINE int hal_uart_read (RINGBUFF_T* rx_ring, void* data, int bytes)
+{
+	return Chip_UART_ReadRB(LPC_USART0, rx_ring, data, bytes);
+}
+
+#endif /* HAL_LPC8XX_H */
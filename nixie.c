@@ -1,15 +1,24 @@
-#include "driver.h"
+#include "nixie.h"
 #include "uart.h"
+#include "transition.h"
+#include "profile.h"
+#include "trace.h"
+#include "supervisor.h"
+#include "fault.h"
+#include "work.h"
+#include "clock.h"
+#include "timer.h"
 
 //#include "stdio.h"
 #include "string.h"
 
 #define INC_START_RATE 3 /* rate at which start when setting button is continuously pushed down */ 
-#define INC_MAX_RATE 100 /* max rate of increasing/decreasing minutes/days when setting new time */
+#define INC_MAX_RATE 100 /* max rate of increasing/decreasing selected field when setting new time */
 #define REFRESH_RATE 1000 /* refresh rate for multiplexing 1 ms = 1000 Hz */
 #define BLANK_RATE 10000 /* blanking interval 100 us = 10000 (2*100 us; first turn off anode, wait 100us, set cathodes, wait 100us, turn on anode */
-#define ROLL_RATE 15 /* roll numbers in 15 Hz when changing from TIME to DATE */
+#define ROLL_RATE 15 /* frame rate of transitions (rolling numbers when changing from TIME to DATE) */
 #define LEAVE_SET_MODE_IN 4 /* leave set mode in 4 seconds when no button is pushed */
+#define STREAM_TIMEOUT 8 /* frames of ROLL_RATE without stream data (about 0.5 s), then the clock is back */
 
 #define SHOW_TIME 90 /* Show time for 90 seconds */
 #define SHOW_DATE 10 /* Show date for 10 seconds */
@@ -20,21 +29,76 @@
 #define SET_MODE_BLINK	2
 #define SET_MODE_INC	3
 
+#define ALL_TUBES 0x3F /* one bit per anode, bit 0 = seconds */
+
+/* Interrupt priorities, 0 is the highest. Edges of anodes are timed by MRT interrupt, nothing
+may delay it or on-time of tubes varies and so does their brightness. Handlers below it
+only post work (work.h), it runs in PendSV at the lowest level together with SysTick */
+#define PRIO_DISPLAY 0 /* MRT - multiplexing slots */
+#define PRIO_INPUT 1 /* PININT buttons, UART0 reception */
+#define PRIO_HOUSEKEEPING (HAL_IRQ_PRIORITIES - 1) /* SysTick (set by hal_systick_init), PendSV */
+
+/* phases of one multiplexing slot, TIMER_BLANK moves to the next one */
+#define SLOT_BLANK 0 /* all anodes off, next: set cathode */
+#define SLOT_CATHODE 1 /* cathode set, next: turn anode on */
+#define SLOT_FADE 2 /* anode on with old number of crossfade, next: set new number */
+#define SLOT_ON 3 /* anode on till the end of slot */
+
 volatile time_t my_time;
 volatile uint8_t anode_ON = 0;
 volatile uint8_t set_mode = NOT_IN_SET_MODE;
-volatile display_t to_display;
 volatile display_t user_data;
 volatile bool blink = FALSE;
 volatile int8_t set_value;
 volatile uint8_t leave_set_mode = 0;
+volatile date_time set_field = MINUTES; /* field changed by +/- buttons in set mode */
+volatile uint8_t blink_mask = ALL_TUBES; /* tubes which blink in set mode */
+volatile display_frame_t display_frames[2]; /* shown one is display_frames[display_seq & 1] */
+volatile uint8_t display_seq = 0; /* frames published by PendSV */
+static display_frame_t frame_work; /* next frame, PendSV only */
+uint32_t fade_interval[FADE_STEPS + 1]; /* on-time of old digits for each fade level in MRT ticks */
+static display_t stream_frames[2]; /* newest one is stream_frames[stream_seq & 1], main loop writes the other */
+static volatile uint8_t stream_seq = 0; /* stream frames received */
+static uint8_t stream_shown = 0; /* stream_seq of frame in display, PendSV only */
+static uint8_t stream_age = 0; /* frames of ROLL_RATE since the last stream frame, PendSV only */
 
-void SysTick_Handler(void)
+/* tubes showing given field, date is displayed as DD.MM.YY */
+static const uint8_t field_tubes[] = {
+	0x03,	/* SECONDS */
+	0x0C,	/* MINUTES */
+	0x30,	/* HOURS */
+	0x30,	/* DAYS */
+	0x0C,	/* MONTHS */
+	0x03	/* YEARS */
+};
+
+/* Select field to be set and display time or date where the field is, only selected field blinks */
+void select_set_field (date_time field)
+{
+	set_field = field;
+	blink_mask = field_tubes[field];
+	
+	if ((field == HOURS) || (field == MINUTES))
+	{
+		my_time.curr_displayed = TIME;
+	}
+	else
+	{
+		my_time.curr_displayed = DATE;
+	}
+}
+
+/* One second - clock, rotation of displayed data, set mode timeout (PendSV) */
+static void second_tick (void)
 {
+	display_dirty = TRUE;
+	
 	switch (set_mode)
 	{
 		case NOT_IN_SET_MODE:
+			PROFILE_START(PROF_TIME_INC_DEC);
 			time_inc_dec(&my_time, +1, SECONDS);
+			PROFILE_END(PROF_TIME_INC_DEC);
 			blink = FALSE;
 			
 			my_time.change_display_timeout++;	
@@ -73,18 +137,19 @@ void SysTick_Handler(void)
 				leave_set_mode = 0;
 				
 				set_mode = NOT_IN_SET_MODE;
+				blink_mask = ALL_TUBES;
 				
 				my_time.change_display_timeout = 0;
 				
 				/* disable interrupt for +/- buttons handlers */
-				NVIC_DisableIRQ(PININT0_IRQn);
-				NVIC_DisableIRQ(PININT1_IRQn);
+				hal_irq_disable(HAL_IRQ_PININT0);
+				hal_irq_disable(HAL_IRQ_PININT1);
 				
 				/* Clear pending IRQs for buttons */
-				NVIC_ClearPendingIRQ(PININT2_IRQn);
+				hal_irq_clear_pending(HAL_IRQ_PININT2);
 				
 				/* enable interrupt for change displayed data (time/date) */
-				NVIC_EnableIRQ(PININT2_IRQn);
+				hal_irq_enable(HAL_IRQ_PININT2);
 			}
 			break;
 			
@@ -93,274 +158,431 @@ void SysTick_Handler(void)
 			break;
 	}
 }
-volatile bool turn_anode_on = FALSE;
-void MRT_IRQHandler(void)
+
+void SysTick_Handler(void)
 {
-	uint32_t int_pend;
-	uint32_t interval_val;
+	TRACE(TRACE_ISR, TR_SYSTICK_ENTER, 0);
+	PROFILE_START(PROF_SYSTICK);
 	
-	/* Get interrupt pending status for all timers */
-	int_pend = Chip_MRT_GetIntPending();
-	Chip_MRT_ClearIntPending(int_pend);
+	/* only when all tasks met their deadlines */
+	supervisor_feed();
+	
+	work_post(PRIO_HOUSEKEEPING, WORK_TICK, 0);
+	
+	PROFILE_END(PROF_SYSTICK);
+	TRACE(TRACE_ISR, TR_SYSTICK_EXIT, 0);
+}
+volatile uint8_t slot_phase = SLOT_BLANK;
+static uint8_t slot_number; /* new number of current slot */
+static uint8_t slot_fade; /* fade level of current slot */
 
-	if (set_mode == NOT_IN_SET_MODE)
-	{		
-		/* Channel 3 - speed of numbers rolling*/
-		if (int_pend & MRTn_INTFLAG(3))
-		{
-			roll_numbers(&my_time, &user_data, &to_display);	
-		}
-	}
-	else if (my_time.curr_displayed == TIME) /* if in SET MODE and time to be displayed */
+/* Precompute crossfade schedule, on-time of anode is split between old and new digits */
+void crossfade_init (void)
+{
+	uint32_t on_time;
+	uint8_t level;
+	
+	on_time = (hal_clock_rate() / REFRESH_RATE) - 2 * (hal_clock_rate() / BLANK_RATE);
+	
+	for (level = 0; level <= FADE_STEPS; level++)
 	{
-		to_display.seconds = to_BCD(my_time.seconds);
-		to_display.minutes = to_BCD(my_time.minutes);
-		to_display.hours = to_BCD(my_time.hours);
+		fade_interval[level] = (on_time * (FADE_STEPS - level)) / FADE_STEPS;
 	}
-	else /* in SET MODE and date to be displayed */
+}
+
+/* Clock manager changed the rate, timer service took care of the periods (interrupts are disabled) */
+static void display_clock_changed (void)
+{
+	crossfade_init();
+}
+
+/* number to be displayed by given tube */
+HAL_RAMFUNC uint8_t tube_number (volatile display_t* display, uint8_t anode)
+{
+	switch(anode)
 	{
-		to_display.seconds = to_BCD(year_to_number(my_time.years));
-		to_display.minutes = to_BCD(my_time.months);
-		to_display.hours = to_BCD(my_time.days);
+		case 0:
+			return display->seconds & 0x0F;
+		case 1:
+			return display->seconds >> 4;
+		case 2:
+			return display->minutes & 0x0F;
+		case 3:
+			return display->minutes >> 4;
+		case 4:
+			return display->hours & 0x0F;
+		default:
+			return display->hours >> 4;
 	}
+}
+
+/* Display sequencer, executed from RAM with RAM_ISR */
+HAL_RAMFUNC void MRT_IRQHandler(void)
+{
+	uint32_t int_pend;
+	volatile display_frame_t* frame;
+	
+	TRACE(TRACE_ISR, TR_MRT_ENTER, 0);
+	
+	/* both started, the one of mode at exit is recorded */
+	PROFILE_START(PROF_MRT_DISPLAY);
+	PROFILE_START(PROF_MRT_SET_MODE);
+	
+	/* Get interrupt pending status for all timers */
+	int_pend = hal_timer_pending();
 	
-	/* Channel 0 - base period for multiplexing */
-	if (int_pend & MRTn_INTFLAG(0)) 
+	/* Base period for multiplexing */
+	if (timer_expired(int_pend, TIMER_REFRESH)) 
 	{
-		/* Enable timer 1 in single one mode to limit blanking interval */
-		setupMRT(1, MRT_MODE_ONESHOT, BLANK_RATE);
-		turn_anode_on = FALSE;
+		PROFILE_REFRESH();
+		supervisor_check_in(SUP_DISPLAY);
+		
+		/* One-shot timer limits blanking interval */
+		timer_start(TIMER_BLANK);
+		slot_phase = SLOT_BLANK;
 		
 		/* Blanking interval */
-		Chip_GPIO_SetPinOutLow(LPC_GPIO_PORT, 0, SEC_TENS);
-		Chip_GPIO_SetPinOutLow(LPC_GPIO_PORT, 0, SEC);
-		Chip_GPIO_SetPinOutLow(LPC_GPIO_PORT, 0, MINUT_TENS);
-		Chip_GPIO_SetPinOutLow(LPC_GPIO_PORT, 0, MINUT);
-		Chip_GPIO_SetPinOutLow(LPC_GPIO_PORT, 0, HOUR_TENS);
-		Chip_GPIO_SetPinOutLow(LPC_GPIO_PORT, 0, HOUR);
-			
-		anode_ON++;
-		if (anode_ON > 5)
-		{
-			anode_ON = 0;
-		}	
+		hal_gpio_clear_mask(ANODE_MASK);
+		
+		/* tubes with blank digits get no slot */
+		anode_ON = display_frames[display_seq & 0x01].next_tube[anode_ON];
 	}
 
-	/* Channel 1 is single shot - limits blanking interval */
-	if ((int_pend & MRTn_INTFLAG(1)) && !blink) 
+	/* One-shot timer limits blanking interval, blinking tubes are left blank */
+	if (timer_expired(int_pend, TIMER_BLANK) && !(blink && (blink_mask & (1 << anode_ON)))) 
 	{
-		if (turn_anode_on == FALSE)
+		if (slot_phase == SLOT_BLANK)
 		{
-			/* Enable timer 1 in single one mode to limit blanking interval */
-			setupMRT(1, MRT_MODE_ONESHOT, BLANK_RATE);
-			turn_anode_on = TRUE;
+			/* Cathode phase is as long as the blanking one */
+			timer_start(TIMER_BLANK);
+			slot_phase = SLOT_CATHODE;
+			
+			/* The whole slot shows one frame, PendSV writes the next one into the other buffer */
+			frame = &display_frames[display_seq & 0x01];
+			slot_number = tube_number(&frame->digits, anode_ON);
+			slot_fade = frame->fade_level;
 			
-			/* Set number (cathode) for the nixie anode which will be turned ON in next interrupt */ 
-			switch(anode_ON)
+			/* Set number (cathode) for the nixie anode which will be turned ON in next interrupt,
+			old number goes first during crossfade */ 
+			if (slot_fade < FADE_STEPS)
 			{
-				case 0:
-					set_number(to_display.seconds & 0x0F);
-				break;
-				case 1:
-					set_number(to_display.seconds >> 4);
-				break;
-				case 2:
-					set_number(to_display.minutes & 0x0F);
-				break;
-				case 3:
-					set_number(to_display.minutes >> 4);
-				break;
-				case 4:
-					set_number(to_display.hours & 0x0F);
-				break;
-				case 5:
-					set_number(to_display.hours >> 4);
-				break;
-			}		
+				set_number(tube_number(&frame->fade_from, anode_ON));
+			}
+			else
+			{
+				set_number(slot_number);
+			}
+		}
+		else if (slot_phase == SLOT_FADE)
+		{
+			/* old number had its share of on-time, switch to the new one */
+			slot_phase = SLOT_ON;
+			set_number(slot_number);
 		}
-		else /* turn anode ON */
+		else if (slot_phase == SLOT_CATHODE) /* turn anode ON */
 		{
-			turn_anode_on = FALSE;
-			switch(anode_ON)
+			if ((slot_fade > 0) && (slot_fade < FADE_STEPS))
 			{
-				case 0:
-					Chip_GPIO_SetPinOutHigh(LPC_GPIO_PORT, 0, SEC);
-				break;
-				case 1:
-					 Chip_GPIO_SetPinOutHigh(LPC_GPIO_PORT, 0, SEC_TENS);
-				break;
-				case 2:
-					Chip_GPIO_SetPinOutHigh(LPC_GPIO_PORT, 0, MINUT);
-				break;
-				case 3:
-					Chip_GPIO_SetPinOutHigh(LPC_GPIO_PORT, 0, MINUT_TENS);
-				break;
-				case 4:
-					Chip_GPIO_SetPinOutHigh(LPC_GPIO_PORT, 0, HOUR);
-				break;
-				case 5:
-					Chip_GPIO_SetPinOutHigh(LPC_GPIO_PORT, 0, HOUR_TENS);
-				break;
+				/* second cathode phase - new number after precomputed on-time of old one */
+				timer_rearm(TIMER_BLANK, fade_interval[slot_fade]);
+				slot_phase = SLOT_FADE;
 			}
+			else
+			{
+				slot_phase = SLOT_ON;
+			}
+			
+			hal_gpio_set(anode_pin[anode_ON]);
+			PROFILE_ANODE_ON();
 		}
 	}
 	
-	/* Channel 2 - to enter setting and to increase setting speed when in set mode*/
-	if (int_pend & MRTn_INTFLAG(2))		
-	{			
-		switch(set_mode) 
+	/* Frame rate of transitions */
+	if (timer_expired(int_pend, TIMER_ROLL))
+	{
+		work_post(PRIO_DISPLAY, WORK_FRAME, 0);
+	}
+	
+	/* To enter setting and to increase setting speed when in set mode */
+	if (timer_expired(int_pend, TIMER_SETTING))
+	{
+		work_post(PRIO_DISPLAY, WORK_REPEAT, 0);
+	}
+	
+	if (set_mode == NOT_IN_SET_MODE)
+	{
+		PROFILE_END(PROF_MRT_DISPLAY);
+	}
+	else
+	{
+		PROFILE_END(PROF_MRT_SET_MODE);
+	}
+	
+	TRACE(TRACE_ISR, TR_MRT_EXIT, 0);
+}
+
+/* Multiplexing order of frame - lit tubes from the right one, each of n lit tubes gets 1/n
+of the time instead of 1/6, so fewer digits are brighter at the same anode current.
+Tubes with a digit or an old digit of crossfade are lit, all of them if none is */
+static void display_schedule (display_frame_t* frame)
+{
+	uint8_t lit = 0;
+	uint8_t tube;
+	uint8_t next;
+	
+	for (tube = 0; tube < BOARD_TUBES; tube++)
+	{
+		if ((tube_number(&frame->digits, tube) != BLANK_DIGIT) ||
+			((frame->fade_level < FADE_STEPS) && (tube_number(&frame->fade_from, tube) != BLANK_DIGIT)))
 		{
-			case SET_MODE_INC:
-				if (my_time.curr_displayed == TIME)
-				{
-					time_inc_dec(&my_time, set_value, MINUTES | TIME_ONLY);
-				}
-				else
-				{
-					time_inc_dec(&my_time, set_value, DAYS);
-				}
-				
-				interval_val = Chip_MRT_GetInterval(Chip_MRT_GetRegPtr(2));
-				interval_val -= interval_val/6;
-				
-				if (interval_val < (Chip_Clock_GetSystemClockRate() / INC_MAX_RATE))
-				{
-					interval_val = (Chip_Clock_GetSystemClockRate() / INC_MAX_RATE);
-				}
-				Chip_MRT_SetInterval(Chip_MRT_GetRegPtr(2), interval_val);
-				break;
-				
-			case NOT_IN_SET_MODE:
-				set_mode = PRE_SET_MODE;
-				break;
+			lit |= 1 << tube;
 		}
 	}
+	
+	if (lit == 0)
+	{
+		lit = ALL_TUBES;
+	}
+	
+	for (tube = 0; tube < BOARD_TUBES; tube++)
+	{
+		next = tube;
+		do
+		{
+			next = (next < (BOARD_TUBES - 1)) ? (next + 1) : 0;
+		} while (!(lit & (1 << next)));
+		
+		frame->next_tube[tube] = next;
+	}
+}
+
+/* Next frame becomes the shown one, multiplexing switches to it with a single write
+and always reads a complete frame (PendSV only) */
+static void display_publish (void)
+{
+	display_schedule(&frame_work);
+	display_frames[(display_seq + 1) & 0x01] = frame_work;
+	display_seq++;
 }
 
-Chip_PININT_BITSLICE_CFG_T Chip_PININT_GetBitsliceConfig(LPC_PIN_INT_T *pPININT, Chip_PININT_BITSLICE_T slice)
+/* Copy of shown frame for main loop, read again when PendSV published a frame meanwhile */
+void display_read (display_frame_t* frame)
 {
-	uint32_t pmcfg_reg;
-		 
-	/* Configure bit slice configuration */
-	pmcfg_reg = pPININT->PMCFG & (PININT_SRC_BITCFG_MASK << (PININT_SRC_BITCFG_START + (slice * 3)));
-	pmcfg_reg = pmcfg_reg >> (PININT_SRC_BITCFG_START + (slice * 3));
+	uint8_t seq;
 	
-	return (Chip_PININT_BITSLICE_CFG_T)pmcfg_reg;
+	do
+	{
+		seq = display_seq;
+		*frame = display_frames[seq & 0x01];
+	} while (seq != display_seq);
 }
 
-/* Clock setting - decrement (-)*/
-void PININT0_IRQHandler(void)
+/* Frame of display stream (main loop), blank_mask has a bit per tube (bit 0 = seconds), FALSE
+in set mode. It goes to the buffer PendSV does not read, a frame not taken yet is replaced by
+the newer one, the caller switches curr_displayed to STREAM_DATA */
+bool display_stream (const display_t* digits, uint8_t blank_mask)
 {
-	set_value = -1;
+	/* BLANK_DIGIT in nibbles of two tubes of one byte */
+	static const uint8_t blank_pair[4] = {0x00, BLANK_DIGIT, BLANK_DIGIT << 4, (BLANK_DIGIT << 4) | BLANK_DIGIT};
+	display_t* frame;
 	
-	if (Chip_PININT_GetBitsliceConfig(LPC_PININT, PININTBITSLICE0) == PININT_PATTERNLOW)
+	if (set_mode != NOT_IN_SET_MODE)
 	{
-		Chip_PININT_SetPatternMatchConfig(LPC_PININT, PININTBITSLICE0, PININT_PATTERNHIGH, TRUE);
-		if (my_time.curr_displayed == TIME) 
-		{
-			my_time.seconds = 0;
-			time_inc_dec(&my_time, set_value, MINUTES | TIME_ONLY);
-		}
-		else
-		{
-			time_inc_dec(&my_time, set_value, DAYS);
-		}
+		return FALSE;
+	}
+	
+	frame = &stream_frames[(stream_seq + 1) & 0x01];
+	frame->seconds = digits->seconds | blank_pair[blank_mask & 0x03];
+	frame->minutes = digits->minutes | blank_pair[(blank_mask >> 2) & 0x03];
+	frame->hours = digits->hours | blank_pair[(blank_mask >> 4) & 0x03];
+	frame->pad = 0;
+	
+	stream_seq++;
+	hal_pendsv_set();
+	
+	return TRUE;
+}
 
-		set_mode = SET_MODE_INC;
-		blink = FALSE;
-		leave_set_mode = 0;
-		setupMRT(2, MRT_MODE_REPEAT, INC_START_RATE);/* start at x Hz */
-		
+/* The newest stream frame goes to display as it is - no transition, no crossfade (PendSV).
+A running transition is dropped, FALSE when no new frame came */
+static bool stream_show (void)
+{
+	uint8_t seq = stream_seq;
+	
+	if (seq == stream_shown)
+	{
+		return FALSE;
 	}
-	else if (Chip_PININT_GetBitsliceConfig(LPC_PININT, PININTBITSLICE0) == PININT_PATTERNHIGH)
+	
+	stream_shown = seq;
+	stream_age = 0;
+	
+	transition_cancel();
+	frame_work.digits = stream_frames[seq & 0x01];
+	frame_work.fade_level = FADE_STEPS;
+	
+	return TRUE;
+}
+
+/* Stream watchdog at ROLL_RATE (PendSV), the clock is back when frames stop coming */
+static void stream_watchdog (void)
+{
+	stream_age++;
+	if (stream_age > STREAM_TIMEOUT)
 	{
-		Chip_PININT_SetPatternMatchConfig(LPC_PININT, PININTBITSLICE0, PININT_PATTERNLOW, TRUE);
-		
-		set_mode = SET_MODE_BLINK;
-		Chip_MRT_SetInterval(Chip_MRT_GetRegPtr(2), 0 | MRT_INTVAL_LOAD); /* stop the timer */
-		Chip_MRT_SetDisabled(Chip_MRT_GetRegPtr(2));
+		stream_age = 0;
+		my_time.curr_displayed = TIME | LOCK;
+		my_time.change_display_timeout = 0;
+		display_dirty = TRUE;
 	}
 }
 
-/* Clock setting - increment (+) */
-void PININT1_IRQHandler(void)
+/* Display recompute in set mode, digits follow the field being set */
+static void set_mode_display (void)
 {
-	set_value = +1;
+	frame_work.fade_level = FADE_STEPS; /* crossfade could be interrupted by set mode */
 	
-	if (Chip_PININT_GetBitsliceConfig(LPC_PININT, PININTBITSLICE1) == PININT_PATTERNLOW)
+	PROFILE_START(PROF_TO_BCD);
+	if (my_time.curr_displayed == TIME) /* if in SET MODE and time to be displayed */
 	{
-		Chip_PININT_SetPatternMatchConfig(LPC_PININT, PININTBITSLICE1, PININT_PATTERNHIGH, TRUE);
-		if (my_time.curr_displayed == TIME)
+		frame_work.digits.seconds = TIME_DIGITS(my_time.seconds);
+		frame_work.digits.minutes = TIME_DIGITS(my_time.minutes);
+		frame_work.digits.hours = TIME_DIGITS(my_time.hours);
+	}
+	else /* in SET MODE and date to be displayed */
+	{
+		frame_work.digits.seconds = to_BCD(year_to_number(my_time.years));
+		frame_work.digits.minutes = to_BCD(my_time.months);
+		frame_work.digits.hours = to_BCD(my_time.days);
+	}
+	display_blank(&frame_work.digits, my_time.curr_displayed & ~LOCK);
+	PROFILE_END(PROF_TO_BCD);
+}
+
+/* TIMER_SETTING - to enter setting and to increase setting speed when in set mode */
+static void setting_repeat (void)
+{
+	uint32_t interval_val;
+	
+	display_dirty = TRUE;
+	
+	switch(set_mode) 
+	{
+		case SET_MODE_INC:
+			field_inc_dec(&my_time, set_value, set_field);
+			
+			interval_val = timer_interval(TIMER_SETTING);
+			interval_val -= interval_val/6;
+			
+			if (interval_val < (hal_clock_rate() / INC_MAX_RATE))
+			{
+				interval_val = (hal_clock_rate() / INC_MAX_RATE);
+			}
+			timer_set_interval(TIMER_SETTING, interval_val);
+			break;
+			
+		case NOT_IN_SET_MODE:
+			/* entry is a single period of the repeated timer */
+			timer_stop(TIMER_SETTING);
+			set_mode = PRE_SET_MODE;
+			break;
+	}
+}
+
+/* Clock setting - button of pin interrupt channel 0 decrements (-), of channel 1 increments (+) */
+static void set_button (uint8_t channel, bool pressed)
+{
+	set_value = (channel == 0) ? -1 : +1;
+	display_dirty = TRUE;
+	
+	if (pressed)
+	{
+		if ((set_field == HOURS) || (set_field == MINUTES))
 		{
 			my_time.seconds = 0;
-			time_inc_dec(&my_time, set_value, MINUTES | TIME_ONLY);
-		}
-		else
-		{
-			time_inc_dec(&my_time, set_value, DAYS);
 		}
+		field_inc_dec(&my_time, set_value, set_field);
 
 		set_mode = SET_MODE_INC;
 		blink = FALSE;
 		leave_set_mode = 0;
-		setupMRT(2, MRT_MODE_REPEAT, INC_START_RATE);/* start at x Hz */
-
+		timer_start(TIMER_SETTING); /* start at INC_START_RATE */
 	}
-	else if (Chip_PININT_GetBitsliceConfig(LPC_PININT, PININTBITSLICE1) == PININT_PATTERNHIGH)
+	else
 	{
-		Chip_PININT_SetPatternMatchConfig(LPC_PININT, PININTBITSLICE1, PININT_PATTERNLOW, TRUE);
-		
 		set_mode = SET_MODE_BLINK;
-		Chip_MRT_SetInterval(Chip_MRT_GetRegPtr(2), 0 | MRT_INTVAL_LOAD); /* stop the timer */
-		Chip_MRT_SetDisabled(Chip_MRT_GetRegPtr(2));
+		timer_stop(TIMER_SETTING);
 	}
 }
 
-
-void PININT3_IRQHandler(void)
+/* Both buttons (pin interrupt channel 3) - set mode entry, next field, time/date */
+static void both_buttons (bool pressed)
 {
-	/* if user data is displayed, setting cannot be entered and display cannot be changed between time/date */
-	if (my_time.curr_displayed == USER_DATA)
-	{
-		return;
-	}
+	display_dirty = TRUE;
 	
-	if (LPC_PININT->PMCTRL & PININT_PMCTRL_PMATCH_SEL)
+	if (pressed)
 	{
-			//my_time.seconds = 33;
-		//Chip_PININT_DisablePatternMatch(LPC_PININT);
+		if ((set_mode == SET_MODE_BLINK) || (set_mode == SET_MODE_INC))
+		{
+			/* both buttons pushed in set mode - select next field, -1 and +1 done by 
+			set_button of each button cancel each other */
+			timer_stop(TIMER_SETTING);
+			
+			set_mode = SET_MODE_BLINK;
+			leave_set_mode = 0;
+			
+			switch (set_field)
+			{
+				case HOURS:
+					select_set_field(MINUTES);
+					break;
+				case MINUTES:
+					select_set_field(DAYS);
+					break;
+				case DAYS:
+					select_set_field(MONTHS);
+					break;
+				case MONTHS:
+					select_set_field(YEARS);
+					break;
+				default:
+					select_set_field(HOURS);
+					break;
+			}
+		}
+		else
+		{
+			timer_rearm(TIMER_SETTING, hal_clock_rate()); /* 1 s to set mode */
+		}
 	}
-	
-	if (Chip_PININT_GetBitsliceConfig(LPC_PININT, PININTBITSLICE2) == PININT_PATTERNLOW)
+	else
 	{
-		Chip_PININT_SetPatternMatchConfig(LPC_PININT, PININTBITSLICE2, PININT_PATTERNHIGH, FALSE);
-		Chip_PININT_SetPatternMatchConfig(LPC_PININT, PININTBITSLICE3, PININT_PATTERNHIGH, TRUE);
-		
-		setupMRT(2, MRT_MODE_ONESHOT, 1);
-	}
-	else if (Chip_PININT_GetBitsliceConfig(LPC_PININT, PININTBITSLICE2) == PININT_PATTERNHIGH)
-	{		
-		Chip_PININT_SetPatternMatchConfig(LPC_PININT, PININTBITSLICE2, PININT_PATTERNLOW, FALSE);
-		Chip_PININT_SetPatternMatchConfig(LPC_PININT, PININTBITSLICE3, PININT_PATTERNLOW, TRUE);
-		
-		/* stop the timer */
-		Chip_MRT_SetInterval(Chip_MRT_GetRegPtr(2), 0 | MRT_INTVAL_LOAD); 
-		Chip_MRT_SetDisabled(Chip_MRT_GetRegPtr(2));
+		timer_stop(TIMER_SETTING);
 		
 		if (set_mode == PRE_SET_MODE)
 		{
 			/* enable set mode only after two buttons go high */
 			set_mode = SET_MODE_BLINK;
 			
+			/* start with field changed so far - minutes for time, days for date */
+			if ((my_time.curr_displayed & ~LOCK) == TIME)
+			{
+				select_set_field(MINUTES);
+			}
+			else
+			{
+				select_set_field(DAYS);
+			}
+			
 			/* Clear pending IRQs for buttons */
-			NVIC_ClearPendingIRQ(PININT0_IRQn);
-			NVIC_ClearPendingIRQ(PININT1_IRQn);
+			hal_irq_clear_pending(HAL_IRQ_PININT0);
+			hal_irq_clear_pending(HAL_IRQ_PININT1);
 			/* enable interrupt for +/- buttons handlers */	
-			NVIC_EnableIRQ(PININT0_IRQn);
-			NVIC_EnableIRQ(PININT1_IRQn);
+			hal_irq_enable(HAL_IRQ_PININT0);
+			hal_irq_enable(HAL_IRQ_PININT1);
 			
 			/* disable interrupt for change displayed data (time/date) */
-			NVIC_DisableIRQ(PININT2_IRQn);
+			hal_irq_disable(HAL_IRQ_PININT2);
 		}
 		
 		if (set_mode == NOT_IN_SET_MODE)
@@ -378,83 +600,280 @@ void PININT3_IRQHandler(void)
 	}
 }
 
-int main(void)
+/* Work posted by interrupts, runs at the lowest priority so the display and buttons preempt it */
+void PendSV_Handler(void)
+{
+	work_t work;
+	bool frame_changed = FALSE;
+	
+	TRACE(TRACE_ISR, TR_PENDSV_ENTER, 0);
+	PROFILE_START(PROF_PENDSV);
+	
+	/* main loop is writing time, work stays queued till it ends */
+	if (!time_write_try())
+	{
+		PROFILE_END(PROF_PENDSV);
+		TRACE(TRACE_ISR, TR_PENDSV_EXIT, 0);
+		return;
+	}
+	
+	while (work_get(&work))
+	{
+		switch (work.type)
+		{
+			case WORK_TICK:
+				second_tick();
+				break;
+				
+			case WORK_FRAME:
+				if (my_time.curr_displayed == STREAM_DATA)
+				{
+					stream_watchdog();
+				}
+				else if (set_mode == NOT_IN_SET_MODE)
+				{
+					PROFILE_START(PROF_TRANSITION_TICK);
+					frame_changed |= transition_tick(&my_time, &frame_work);
+					PROFILE_END(PROF_TRANSITION_TICK);
+					
+					/* the last frame, next change may be waiting for it */
+					if (frame_changed && !transition_running())
+					{
+						display_dirty = TRUE;
+					}
+				}
+				break;
+				
+			case WORK_REPEAT:
+				setting_repeat();
+				break;
+				
+			case WORK_PRESS:
+			case WORK_RELEASE:
+				if (work.data == 3)
+				{
+					both_buttons(work.type == WORK_PRESS);
+				}
+				else
+				{
+					set_button(work.data, work.type == WORK_PRESS);
+				}
+				break;
+		}
+	}
+	
+	if (my_time.curr_displayed == STREAM_DATA)
+	{
+		frame_changed |= stream_show();
+	}
+	
+	if ((set_mode != NOT_IN_SET_MODE) && display_dirty)
+	{
+		display_dirty = FALSE;
+		set_mode_display();
+		frame_changed = TRUE;
+	}
+	
+	time_write_end();
+	
+	if (frame_changed)
+	{
+		display_publish();
+	}
+	
+	PROFILE_END(PROF_PENDSV);
+	TRACE(TRACE_ISR, TR_PENDSV_EXIT, 0);
+}
+
+/* Prepare transition to data to be displayed, display itself is driven by MRT interrupt.
+Digits are recomputed only after a change and when the previous transition ended */
+void refresh_display (void)
+{
+	time_t time;
+	display_frame_t frame;
+	
+	if ((set_mode == NOT_IN_SET_MODE) && (my_time.curr_displayed != STREAM_DATA) && display_dirty && !transition_running())
+	{
+		display_dirty = FALSE; /* before the copy, change made during it sets it again */
+		time_read(&my_time, &time);
+		display_read(&frame);
+		display_update(&time, &user_data, &frame.digits);
+	}
+}
+
+/* Pin interrupts only flip their slices to wait for the other edge and post the edge,
+set_button and both_buttons (PendSV) act on it */
+
+/* Clock setting - decrement (-)*/
+void PININT0_IRQHandler(void)
+{
+	TRACE(TRACE_ISR, TR_PININT_ENTER, 0);
+	
+	if (hal_pinint_slice_get(0) == HAL_SLICE_LOW)
+	{
+		hal_pinint_slice_set(0, HAL_SLICE_HIGH, TRUE);
+		work_post(PRIO_INPUT, WORK_PRESS, 0);
+	}
+	else if (hal_pinint_slice_get(0) == HAL_SLICE_HIGH)
+	{
+		hal_pinint_slice_set(0, HAL_SLICE_LOW, TRUE);
+		work_post(PRIO_INPUT, WORK_RELEASE, 0);
+	}
+	
+	TRACE(TRACE_ISR, TR_PININT_EXIT, 0);
+}
+
+/* Clock setting - increment (+) */
+void PININT1_IRQHandler(void)
+{
+	TRACE(TRACE_ISR, TR_PININT_ENTER, 1);
+	
+	if (hal_pinint_slice_get(1) == HAL_SLICE_LOW)
+	{
+		hal_pinint_slice_set(1, HAL_SLICE_HIGH, TRUE);
+		work_post(PRIO_INPUT, WORK_PRESS, 1);
+	}
+	else if (hal_pinint_slice_get(1) == HAL_SLICE_HIGH)
+	{
+		hal_pinint_slice_set(1, HAL_SLICE_LOW, TRUE);
+		work_post(PRIO_INPUT, WORK_RELEASE, 1);
+	}
+	
+	TRACE(TRACE_ISR, TR_PININT_EXIT, 1);
+}
+
+
+void PININT3_IRQHandler(void)
 {
-	uint8_t mrtch = 0;
+	TRACE(TRACE_ISR, TR_PININT_ENTER, 3);
+	
+	/* if user data or stream is displayed, setting cannot be entered and display cannot be changed between time/date */
+	if ((my_time.curr_displayed == USER_DATA) || (my_time.curr_displayed == STREAM_DATA))
+	{
+		TRACE(TRACE_ISR, TR_PININT_EXIT, 3);
+		return;
+	}
 	
+	if (hal_pinint_slice_get(2) == HAL_SLICE_LOW)
+	{
+		hal_pinint_slice_set(2, HAL_SLICE_HIGH, FALSE);
+		hal_pinint_slice_set(3, HAL_SLICE_HIGH, TRUE);
+		work_post(PRIO_INPUT, WORK_PRESS, 3);
+	}
+	else if (hal_pinint_slice_get(2) == HAL_SLICE_HIGH)
+	{		
+		hal_pinint_slice_set(2, HAL_SLICE_LOW, FALSE);
+		hal_pinint_slice_set(3, HAL_SLICE_LOW, TRUE);
+		work_post(PRIO_INPUT, WORK_RELEASE, 3);
+	}
+	
+	TRACE(TRACE_ISR, TR_PININT_EXIT, 3);
+}
+
+/* Trace changes of set mode and displayed data, main loop checks them often enough
+to keep the timestamp close and interrupts stay free of trace points for them */
+static void trace_state (void)
+{
+	static uint8_t traced_set_mode = 0xFF;
+	static uint8_t traced_displayed = 0xFF;
+	uint8_t state;
+	
+	state = set_mode;
+	if (state != traced_set_mode)
+	{
+		traced_set_mode = state;
+		TRACE(TRACE_STATE, TR_SET_MODE, state);
+	}
+	
+	state = my_time.curr_displayed;
+	if (state != traced_displayed)
+	{
+		traced_displayed = state;
+		TRACE(TRACE_STATE, TR_DISPLAYED, state);
+	}
+}
+
+/* Initialize peripherals and clock, interrupts start running */
+void nixie_init (void)
+{
 	/* Initialize system clock */
-	SystemInit();
-	Chip_Clock_EnablePeriphClock(SYSCTL_CLOCK_SWM);
+	hal_system_init();
 	
 	/* Initialize bord, I/O port setting, systick, etc. */
 	board_init();
 	
-	UART_init();
+	/* Cycle profiling, only with PROFILE defined */
+	PROFILE_INIT();
 	
-	/*------------*/
-	//Chip_PININT_Init (LPC_PIN_INT_T *pPININT)
-	/* Configure interrupt channel 0 for the GPIO pin in SysCon block */
-	Chip_SYSCTL_SetPinInterrupt(0, SW1);
-		
-	/* Configure channel 0 as wake up interrupt in SysCon block */
-	/*Chip_SYSCTL_EnablePINTWakeup(0);*/
+	/* Timestamps and ring of trace records */
+	trace_init();
 	
-	/* Configure channel 0 interrupt as edge sensitive and raising/falling edge interrupt */
-/*	Chip_PININT_SetPinModeEdge(LPC_PININT, PININTCH0);
-	Chip_PININT_EnableIntLow(LPC_PININT, PININTCH0);
-	Chip_PININT_EnableIntHigh(LPC_PININT, PININTCH0);*/
+	/* Branch trace for HardFault record, record of previous fault is kept */
+	fault_init();
 	
-	/* Configure interrupt channel 1 for the GPIO pin in SysCon block */
-	Chip_SYSCTL_SetPinInterrupt(1, SW2);
-		
-	/* Configure channel 0 as wake up interrupt in SysCon block */
-	/*Chip_SYSCTL_EnablePINTWakeup(0);*/
+	/* Queues of work posted by interrupts to PendSV */
+	work_init();
 	
-	/* Configure channel 1 interrupt as edge sensitive and raising/falling edge interrupt */
-	/*Chip_PININT_SetPinModeEdge(LPC_PININT, PININTCH1);
-	Chip_PININT_EnableIntLow(LPC_PININT, PININTCH1);
-	Chip_PININT_EnableIntHigh(LPC_PININT, PININTCH1);*/
+	/* Priority plan before interrupts are enabled, SysTick is already at the lowest level */
+	hal_irq_set_priority(HAL_IRQ_MRT, PRIO_DISPLAY);
+	hal_irq_set_priority(HAL_IRQ_PININT0, PRIO_INPUT);
+	hal_irq_set_priority(HAL_IRQ_PININT1, PRIO_INPUT);
+	hal_irq_set_priority(HAL_IRQ_PININT2, PRIO_INPUT);
+	hal_irq_set_priority(HAL_IRQ_PININT3, PRIO_INPUT);
+	hal_irq_set_priority(HAL_IRQ_UART0, PRIO_INPUT);
+	hal_irq_set_priority(HAL_IRQ_PENDSV, PRIO_HOUSEKEEPING);
+	
+	UART_init();
 	
 	/*------------*/
+	/* Configure interrupt channel 0 and 1 for the GPIO pins in SysCon block */
+	hal_pinint_init(0, SW1);
+	hal_pinint_init(1, SW2);
 	
-	Chip_PININT_SetPatternMatchSrc(LPC_PININT, 0, PININTBITSLICE0);
-	Chip_PININT_SetPatternMatchSrc(LPC_PININT, 1, PININTBITSLICE1);
-	Chip_PININT_SetPatternMatchSrc(LPC_PININT, 0, PININTBITSLICE2);
-	Chip_PININT_SetPatternMatchSrc(LPC_PININT, 1, PININTBITSLICE3);
+	/*------------*/
 	
-	Chip_PININT_SetPatternMatchConfig(LPC_PININT, PININTBITSLICE0, PININT_PATTERNLOW, TRUE); 
-	Chip_PININT_SetPatternMatchConfig(LPC_PININT, PININTBITSLICE1, PININT_PATTERNLOW, TRUE);	
-	Chip_PININT_SetPatternMatchConfig(LPC_PININT, PININTBITSLICE2, PININT_PATTERNLOW, FALSE);
-	Chip_PININT_SetPatternMatchConfig(LPC_PININT, PININTBITSLICE3, PININT_PATTERNLOW, TRUE);
+	hal_pinint_slice_src(0, 0);
+	hal_pinint_slice_src(1, 1);
+	hal_pinint_slice_src(2, 0);
+	hal_pinint_slice_src(3, 1);
 	
-	Chip_PININT_SetPatternMatchConfig(LPC_PININT, PININTBITSLICE4, PININT_PATTERCONST0, FALSE);
-	Chip_PININT_SetPatternMatchConfig(LPC_PININT, PININTBITSLICE5, PININT_PATTERCONST0, FALSE);
-	Chip_PININT_SetPatternMatchConfig(LPC_PININT, PININTBITSLICE6, PININT_PATTERCONST0, FALSE);
+	hal_pinint_slice_set(0, HAL_SLICE_LOW, TRUE); 
+	hal_pinint_slice_set(1, HAL_SLICE_LOW, TRUE);	
+	hal_pinint_slice_set(2, HAL_SLICE_LOW, FALSE);
+	hal_pinint_slice_set(3, HAL_SLICE_LOW, TRUE);
 	
-	Chip_PININT_EnablePatternMatch(LPC_PININT);
+	hal_pinint_slice_set(4, HAL_SLICE_CONST0, FALSE);
+	hal_pinint_slice_set(5, HAL_SLICE_CONST0, FALSE);
+	hal_pinint_slice_set(6, HAL_SLICE_CONST0, FALSE);
 	
-	NVIC_EnableIRQ(PININT3_IRQn);
+	hal_pinint_enable_match();
 	
-	/* MRT Initialization and disable all timers */
-	Chip_MRT_Init();
-	for (mrtch = 0; mrtch < MRT_CHANNELS_NUM; mrtch++) {
-		Chip_MRT_SetDisabled(Chip_MRT_GetRegPtr(mrtch));
-	}
+	hal_irq_enable(HAL_IRQ_PININT3);
 	
-	/* Enable the interrupt for the MRT */
-	NVIC_EnableIRQ(MRT_IRQn);
-
-	/* Enable timer 0 in repeat mode - main period for multiplexing*/
-	setupMRT(0, MRT_MODE_REPEAT, REFRESH_RATE);
+	/* Split of anode on-time for crossfade */
+	crossfade_init();
+	
+	/* First frame without crossfade */
+	frame_work.fade_level = FADE_STEPS;
+	display_publish();
 	
-	/* Enable timer 3 in repeat mode - */
-	setupMRT(3, MRT_MODE_REPEAT, ROLL_RATE);
+	/* MRT Initialization, all timers stopped and the interrupt for the MRT enabled,
+	channels by role */
+	timer_init();
+	timer_alloc(TIMER_REFRESH, HAL_TIMER_REPEAT, REFRESH_RATE);
+	timer_alloc(TIMER_BLANK, HAL_TIMER_ONESHOT, BLANK_RATE);
+	timer_alloc(TIMER_SETTING, HAL_TIMER_REPEAT, INC_START_RATE);
+	timer_alloc(TIMER_ROLL, HAL_TIMER_REPEAT, ROLL_RATE);
+	
+	/* Main period for multiplexing and frame rate of transitions run all the time */
+	timer_start(TIMER_REFRESH);
+	timer_start(TIMER_ROLL);
 
 	
 	/* Playground starts here */
 	my_time.seconds = 0;
-	my_time.minutes = 1;
-	my_time.hours = 12;
+	my_time.minutes = TIME_FROM_BIN(1);
+	my_time.hours = TIME_FROM_BIN(12);
 	
 	my_time.days = 31;
 	my_time.months = 12;
@@ -466,16 +885,50 @@ int main(void)
 	my_time.show_time = SHOW_TIME;
 	my_time.show_date = SHOW_DATE;
 	my_time.show_user_data = SHOW_USER_DATA;
+	
+	/* Watchdog, first feed comes with the first SysTick */
+	supervisor_init();
+	
+	/* Idle clock till UART traffic or set mode, all users of the rate are registered */
+	clock_register(display_clock_changed);
+	clock_init();
+}
+
+/* One pass of main loop */
+void nixie_loop (void)
+{
+	supervisor_check_in(SUP_MAIN_LOOP);
+	clock_request(CLOCK_REQ_SET_MODE, set_mode != NOT_IN_SET_MODE);
+	UART_commands_exec(&my_time, &user_data);	
+	refresh_display();
+	trace_state();
+}
 
-#ifdef BOARD_REV1 /* REV1 uses RN42, the below commands are compatible with it only */
-	while(my_time.seconds == 0); /* wait one second prior setting BT to give it enough time to startup */
-	while (!set_BT_power_save (&my_time));
+#ifndef HOST_BUILD /* host program has its own main and calls nixie_init and nixie_loop */
+int main(void)
+{
+	nixie_init();
+	
+#if BOARD_BT_RN42 /* the below commands are compatible with RN42 only */
+	/* module not answering resets the clock, the setup is skipped after such reset */
+	if (!(supervisor_missed() & (1 << SUP_BT_SETUP)))
+	{
+		supervisor_check_in(SUP_BT_SETUP);
+		while(my_time.seconds == 0) /* wait one second prior setting BT to give it enough time to startup */
+		{
+			refresh_display();
+		}
+		while (!set_BT_power_save (&my_time))
+		{
+			refresh_display();
+		}
+		supervisor_stop(SUP_BT_SETUP);
+	}
 #endif
 
 	while(1)
 	{		
-		UART_commands_exec(&my_time, &user_data);	
-		//buttonishi=!Chip_GPIO_ReadPortBit(LPC_GPIO_PORT, 0, SW1);              //button is hi
-		//buttonishioneshot=buttonishi && !buttonishil; //button just went hi
+		nixie_loop();
 	}
 }
+#endif /* HOST_BUILD */
@@ -0,0 +1,39 @@
+#ifndef NIXIE_H
+#define NIXIE_H
+
+#include "driver.h"
+#include "transition.h"
+
+/* Clock state shared by interrupts and main loop */
+extern volatile time_t my_time;
+extern volatile display_t user_data;
+extern volatile uint8_t set_mode;
+
+/* Display and set mode state of MRT_IRQHandler and PendSV, set up by the cycle benchmark
+(cycle_bench.c) */
+extern volatile display_frame_t display_frames[2];
+extern volatile uint8_t display_seq;
+extern volatile uint8_t anode_ON;
+extern volatile bool blink;
+extern volatile uint8_t blink_mask;
+extern volatile uint8_t leave_set_mode;
+extern volatile date_time set_field;
+
+/* Functions definitions */
+void nixie_init (void);
+void nixie_loop (void);
+void refresh_display (void);
+void display_read (display_frame_t* frame);
+bool display_stream (const display_t* digits, uint8_t blank_mask);
+void select_set_field (date_time field);
+
+/* Interrupt handlers */
+void SysTick_Handler (void);
+void MRT_IRQHandler (void);
+void PendSV_Handler (void);
+void PININT0_IRQHandler (void);
+void PININT1_IRQHandler (void);
+void PININT3_IRQHandler (void);
+void UART0_IRQHandler (void);
+
+#endif /* NIXIE_H */
@@ -0,0 +1,175 @@
+#include "profile.h"
+#include "clock.h"
+#include "timer.h"
+
+/* Worst case budget of each path in microseconds, 0 = not checked. Display paths must
+end well within blanking interval (100 us), otherwise multiplexing jitters visibly */
+static const uint8_t budget_us[PROF_PATHS_NUM] = {
+	30,	/* PROF_MRT_DISPLAY */
+	50,	/* PROF_MRT_SET_MODE */
+	40,	/* PROF_SYSTICK */
+	20,	/* PROF_TRANSITION_TICK */
+	20,	/* PROF_TO_BCD */
+	20,	/* PROF_TIME_INC_DEC */
+	0,	/* PROF_UART_CMD */
+	0	/* PROF_PENDSV */
+};
+
+#ifdef PROFILE
+
+static uint32_t budget[PROF_PATHS_NUM]; /* cycles */
+static volatile uint32_t start[PROF_PATHS_NUM]; /* SysTick value */
+static volatile uint32_t max_cycles[PROF_PATHS_NUM];
+static volatile uint8_t over_budget; /* one bit per path */
+static uint32_t cycles_per_tick;
+static uint32_t overhead; /* cycles of empty measurement */
+static volatile uint32_t anode_on_at; /* timestamp */
+static volatile bool anode_lit;
+static volatile uint32_t jitter_min[PROF_JITTER_NUM];
+static volatile uint32_t jitter_max[PROF_JITTER_NUM];
+
+static void jitter_update (profile_jitter_t jitter, uint32_t cycles);
+static void budgets_update (void);
+
+/* SysTick must be running (board_init) */
+void profile_init (void)
+{
+	cycles_per_tick = hal_clock_rate() / hal_systick_rate();
+	
+	budgets_update();
+	clock_register(budgets_update);
+	
+	/* calibrate with empty measurement */
+	overhead = 0;
+	profile_start(PROF_UART_CMD);
+	profile_end(PROF_UART_CMD);
+	overhead = max_cycles[PROF_UART_CMD];
+	
+	profile_reset();
+}
+
+/* Budgets are times, their cycles follow the rate of system clock (clock manager) */
+static void budgets_update (void)
+{
+	uint8_t path;
+	
+	for (path = 0; path < PROF_PATHS_NUM; path++)
+	{
+		budget[path] = budget_us[path] * (hal_clock_rate() / 1000000);
+	}
+}
+
+void profile_start (profile_path_t path)
+{
+	start[path] = hal_systick_value();
+}
+
+void profile_end (profile_path_t path)
+{
+	uint32_t now;
+	uint32_t ticks;
+	uint32_t cycles;
+	
+	now = hal_systick_value();
+	
+	/* counter counts down and wraps from 0 to reload value */
+	if (start[path] >= now)
+	{
+		ticks = start[path] - now;
+	}
+	else
+	{
+		ticks = start[path] + hal_systick_reload() + 1 - now;
+	}
+	
+	cycles = ticks * cycles_per_tick;
+	cycles = (cycles > overhead) ? (cycles - overhead) : 0;
+	
+	if (cycles > max_cycles[path])
+	{
+		max_cycles[path] = cycles;
+		
+		if (budget[path] && (cycles > budget[path]))
+		{
+			over_budget |= 1 << path;
+		}
+	}
+}
+
+void profile_reset (void)
+{
+	uint8_t path;
+	
+	for (path = 0; path < PROF_PATHS_NUM; path++)
+	{
+		max_cycles[path] = 0;
+	}
+	over_budget = 0;
+	
+	for (path = 0; path < PROF_JITTER_NUM; path++)
+	{
+		jitter_min[path] = 0xFFFFFFFF;
+		jitter_max[path] = 0;
+	}
+}
+
+uint32_t profile_max_cycles (profile_path_t path)
+{
+	return max_cycles[path];
+}
+
+uint8_t profile_over_budget (void)
+{
+	return over_budget;
+}
+
+/* Start of multiplexing slot, MRT interrupt with TIMER_REFRESH expired before blanking.
+MRT counts system clock, ticks elapsed since expiry are the latency */
+void profile_refresh (void)
+{
+	jitter_update(PROF_REFRESH_LATENCY, timer_interval(TIMER_REFRESH) - timer_value(TIMER_REFRESH));
+	
+	/* blinking tubes are not turned on */
+	if (anode_lit)
+	{
+		anode_lit = FALSE;
+		jitter_update(PROF_ANODE_ON_TIME, hal_timestamp() - anode_on_at);
+	}
+}
+
+void profile_anode_on (void)
+{
+	anode_on_at = hal_timestamp();
+	anode_lit = TRUE;
+}
+
+static void jitter_update (profile_jitter_t jitter, uint32_t cycles)
+{
+	if (cycles < jitter_min[jitter])
+	{
+		jitter_min[jitter] = cycles;
+	}
+	if (cycles > jitter_max[jitter])
+	{
+		jitter_max[jitter] = cycles;
+	}
+}
+
+/* 0xFFFFFFFF when nothing was measured since reset */
+uint32_t profile_jitter_min (profile_jitter_t jitter)
+{
+	return jitter_min[jitter];
+}
+
+uint32_t profile_jitter_max (profile_jitter_t jitter)
+{
+	return jitter_max[jitter];
+}
+
+#endif /* PROFILE */
+
+/* Budget of path in microseconds, also used by the cycle benchmark (cycle_bench.c) */
+uint8_t profile_budget_us (profile_path_t path)
+{
+	return budget_us[path];
+}
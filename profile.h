@@ -0,0 +1,59 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+/* Cycle profiling of hot paths, built in only with PROFILE defined (e.g. -DPROFILE in Misc Controls
+or cmake -DPROFILE=ON). SysTick counter is the time base, resolution is 2 cycles (SysTick
+runs at half of system clock). Interrupts of higher priority preempting a measured path are
+counted into it, maximum of each path is kept and compared with its budget, exceeded budgets
+are reported by GET|CYCLES. Off the board the same budgets are checked by the cycle benchmark,
+cycle_sim runs cycle_bench.c on an emulated Cortex-M0+ (README.md) */
+
+#include "hal.h"
+
+typedef enum {
+	PROF_MRT_DISPLAY,	/* MRT_IRQHandler out of set mode */
+	PROF_MRT_SET_MODE,	/* MRT_IRQHandler in set mode */
+	PROF_SYSTICK,		/* SysTick_Handler */
+	PROF_TRANSITION_TICK,	/* one frame of transition */
+	PROF_TO_BCD,		/* display recompute in set mode (3x to_BCD) */
+	PROF_TIME_INC_DEC,	/* time_inc_dec of one second */
+	PROF_UART_CMD,		/* one message of UART_commands_exec */
+	PROF_PENDSV,		/* PendSV_Handler - work posted by interrupts */
+	PROF_PATHS_NUM /* Do not change */
+} profile_path_t;
+
+/* Refresh-phase jitter, minimum and maximum in system clock cycles. Anodes are turned on
+and off by MRT interrupt, its latency moves the edges and makes on-time of tubes uneven */
+typedef enum {
+	PROF_REFRESH_LATENCY,	/* expiry of TIMER_REFRESH to blanking */
+	PROF_ANODE_ON_TIME,	/* anode turned on to blanking */
+	PROF_JITTER_NUM /* Do not change */
+} profile_jitter_t;
+
+#ifdef PROFILE
+	#define PROFILE_INIT() profile_init()
+	#define PROFILE_START(path) profile_start(path)
+	#define PROFILE_END(path) profile_end(path)
+	#define PROFILE_REFRESH() profile_refresh()
+	#define PROFILE_ANODE_ON() profile_anode_on()
+#else
+	#define PROFILE_INIT()
+	#define PROFILE_START(path)
+	#define PROFILE_END(path)
+	#define PROFILE_REFRESH()
+	#define PROFILE_ANODE_ON()
+#endif
+
+uint8_t profile_budget_us (profile_path_t path);
+void profile_init (void);
+void profile_start (profile_path_t path);
+void profile_end (profile_path_t path);
+void profile_reset (void);
+uint32_t profile_max_cycles (profile_path_t path);
+uint8_t profile_over_budget (void);
+void profile_refresh (void);
+void profile_anode_on (void);
+uint32_t profile_jitter_min (profile_jitter_t jitter);
+uint32_t profile_jitter_max (profile_jitter_t jitter);
+
+#endif /* PROFILE_H */
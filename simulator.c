@@ -0,0 +1,529 @@
+/* Virtual time simulator of the clock for Linux (host build, see README.md).
+
+Runs the unmodified clock logic - interrupt handlers and main loop of nixie.c -
+against peripherals emulated by hal_host.c. Time is virtual and moves from one
+event (timer expiration, SysTick, scripted input) to the next one, interrupts
+are executed in zero time, main loop runs once after each event. Missed watchdog
+timeouts and feeds violating its window are reported.
+
+Usage: simulator [-n] [-g gpio_trace] [-t duration] [script]
+	-n	no display multiplexing (MRT channels 0 and 1 are not run), needed to simulate years in seconds
+	-g	record every GPIO transition as "time;port value" into file
+	-t	simulated time, default is the time of the last script line
+
+Script (stdin if not given), one event per line, time from start with optional unit ms/s/m/h/d (default s):
+	10s press SW1|SW2	button pushed down
+	12s release SW1|SW2	button released
+	1m uart 7D 11 0C 1E 00 00	bytes received by UART
+	2d dump	print date, time and displayed digits
+	# comment */
+
+#include <stdio.h>
+#include <string.h>
+#include "nixie.h" /* stdlib.h is not used, its time_t collides with the one of driver.h */
+#include "transition.h"
+#include "supervisor.h"
+#include "timer.h"
+
+#define LINE_SIZE 256
+#define UART_MAX_BYTES 64
+
+typedef uint64_t ticks_t; /* virtual time in ticks of crystal (HOST_CLOCK_RATE) */
+
+typedef enum {
+	EV_PRESS,
+	EV_RELEASE,
+	EV_UART,
+	EV_DUMP,
+	EV_NONE
+} event_type_t;
+
+typedef struct event {
+	ticks_t time;
+	event_type_t type;
+	uint8_t pin;
+	uint8_t data[UART_MAX_BYTES];
+	int bytes;
+} event_t;
+
+static ticks_t now;
+static ticks_t clock_phase; /* ticks since the last tick of divided system clock */
+static bool no_display = FALSE;
+static FILE* gpio_trace = NULL;
+
+static double to_seconds (ticks_t time)
+{
+	return (double)time / HOST_CLOCK_RATE;
+}
+
+static void gpio_changed (uint32_t old_value, uint32_t new_value)
+{
+	(void)old_value;
+	fprintf(gpio_trace, "%.6f;%05X\n", to_seconds(now), (unsigned)new_value);
+}
+
+static void uart_transmit (const uint8_t* data, int bytes)
+{
+	int i;
+
+	printf("%12.6f tx:", to_seconds(now));
+	for (i = 0; i < bytes; i++)
+	{
+		printf(" %02X", data[i]);
+	}
+	printf("\n");
+}
+
+static void dump (void)
+{
+	display_frame_t frame;
+
+	display_read(&frame);
+	printf("%12.6f %02u:%02u:%02u %02u.%02u.%04u displayed %02X%02X%02X shows %u set mode %u\n", to_seconds(now),
+		TIME_TO_BIN(my_time.hours), TIME_TO_BIN(my_time.minutes), TIME_TO_BIN(my_time.seconds), my_time.days, my_time.months, my_time.years,
+		frame.digits.hours, frame.digits.minutes, frame.digits.seconds, my_time.curr_displayed, set_mode);
+}
+
+/* Watchdog of hal_host.c, missed timeout runs the warning handler and is reported
+as the reset would be, the simulation continues */
+static void watchdog_check (void)
+{
+	static uint32_t feeds = 0;
+	static ticks_t last_feed = 0;
+	
+	if (host_peripherals.watchdog_timeout == 0)
+	{
+		return;
+	}
+	
+	if (host_peripherals.watchdog_feeds != feeds)
+	{
+		if ((now - last_feed) < (ticks_t)host_peripherals.watchdog_window * (HOST_CLOCK_RATE / 1000))
+		{
+			printf("%12.6f watchdog fed too early\n", to_seconds(now));
+		}
+		feeds = host_peripherals.watchdog_feeds;
+		last_feed = now;
+	}
+	else if ((now - last_feed) > (ticks_t)host_peripherals.watchdog_timeout * (HOST_CLOCK_RATE / 1000))
+	{
+		NMI_Handler();
+		printf("%12.6f watchdog reset, late tasks %02X\n", to_seconds(now), supervisor_late());
+		last_feed = now;
+	}
+}
+
+/* Parse "<time> <command> [args]", returns FALSE on syntax error, EV_NONE for empty lines */
+static bool parse_line (char* line, event_t* event)
+{
+	char* token;
+	char* end;
+	double value;
+	unsigned byte;
+	int length;
+
+	event->type = EV_NONE;
+	event->bytes = 0;
+
+	token = strtok(line, " \t\r\n");
+	if ((token == NULL) || (token[0] == '#'))
+	{
+		return TRUE;
+	}
+
+	if (sscanf(token, "%lf%n", &value, &length) != 1)
+	{
+		return FALSE;
+	}
+	end = token + length;
+	if (strcmp(end, "ms") == 0)
+	{
+		value /= 1000;
+	}
+	else if (strcmp(end, "m") == 0)
+	{
+		value *= 60;
+	}
+	else if (strcmp(end, "h") == 0)
+	{
+		value *= 3600;
+	}
+	else if (strcmp(end, "d") == 0)
+	{
+		value *= 86400;
+	}
+	else if ((*end != '\0') && (strcmp(end, "s") != 0))
+	{
+		return FALSE;
+	}
+	event->time = (ticks_t)(value * HOST_CLOCK_RATE);
+
+	token = strtok(NULL, " \t\r\n");
+	if (token == NULL)
+	{
+		return FALSE;
+	}
+
+	if ((strcmp(token, "press") == 0) || (strcmp(token, "release") == 0))
+	{
+		event->type = (token[0] == 'p') ? EV_PRESS : EV_RELEASE;
+		token = strtok(NULL, " \t\r\n");
+		if ((token != NULL) && (strcmp(token, "SW1") == 0))
+		{
+			event->pin = SW1;
+		}
+		else if ((token != NULL) && (strcmp(token, "SW2") == 0))
+		{
+			event->pin = SW2;
+		}
+		else
+		{
+			return FALSE;
+		}
+	}
+	else if (strcmp(token, "uart") == 0)
+	{
+		event->type = EV_UART;
+		while (((token = strtok(NULL, " \t\r\n")) != NULL) && (event->bytes < UART_MAX_BYTES))
+		{
+			if ((sscanf(token, "%x%n", &byte, &length) != 1) || (token[length] != '\0') || (byte > 0xFF))
+			{
+				return FALSE;
+			}
+			event->data[event->bytes++] = (uint8_t)byte;
+		}
+	}
+	else if (strcmp(token, "dump") == 0)
+	{
+		event->type = EV_DUMP;
+	}
+	else
+	{
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+/* Handlers by IRQ number of hal_host.h, PININT2 has none (slice 2 is not an end point) */
+static void (* const irq_handler[HAL_IRQ_NUM])(void) = {
+	UART0_IRQHandler,
+	MRT_IRQHandler,
+	PININT0_IRQHandler,
+	PININT1_IRQHandler,
+	NULL,
+	PININT3_IRQHandler,
+	PendSV_Handler
+};
+
+/* Execute pending and enabled interrupts as NVIC does - the highest priority first (set by
+hal_irq_set_priority), lower IRQ number of the same priority first. Handlers run in zero
+time, so preemption is not simulated, only the order */
+static void dispatch_interrupts (void)
+{
+	bool* pending = host_peripherals.irq_pending;
+	bool* enabled = host_peripherals.irq_enabled;
+	int irq;
+	int next;
+
+	do
+	{
+		next = HAL_IRQ_NUM;
+		for (irq = 0; irq < HAL_IRQ_NUM; irq++)
+		{
+			if (pending[irq] && enabled[irq] && ((next == HAL_IRQ_NUM) ||
+				(host_peripherals.irq_priority[irq] < host_peripherals.irq_priority[next])))
+			{
+				next = irq;
+			}
+		}
+
+		if (next < HAL_IRQ_NUM)
+		{
+			pending[next] = FALSE; /* as NVIC on entry of handler */
+			if (irq_handler[next] != NULL)
+			{
+				irq_handler[next]();
+			}
+		}
+	} while (next < HAL_IRQ_NUM);
+}
+
+/* Without display the multiplexing channels are not run and transition frames
+are generated only while a transition is running, idle TIMER_ROLL would be
+the most frequent event otherwise */
+static bool timer_simulated (uint8_t ch)
+{
+	if (!no_display)
+	{
+		return TRUE;
+	}
+
+	return (ch == timer_channel(TIMER_SETTING)) || ((ch == timer_channel(TIMER_ROLL)) && transition_running());
+}
+
+/* Ticks of system clock in elapsed ticks of virtual time, the rest is kept for the next call */
+static ticks_t system_ticks (ticks_t elapsed)
+{
+	ticks_t ticks;
+
+	clock_phase += elapsed;
+	ticks = clock_phase / host_peripherals.clock_divider;
+	clock_phase %= host_peripherals.clock_divider;
+
+	return ticks;
+}
+
+/* System clock ticks to the next expiration of running timer channel, 0 if none */
+static ticks_t timer_next (void)
+{
+	ticks_t next = 0;
+	uint8_t ch;
+
+	for (ch = 0; ch < HAL_TIMER_CHANNELS; ch++)
+	{
+		if (timer_simulated(ch) && host_peripherals.timer[ch].running && ((next == 0) || (host_peripherals.timer[ch].value < next)))
+		{
+			next = host_peripherals.timer[ch].value;
+		}
+	}
+
+	return next;
+}
+
+/* Move timers by elapsed ticks, expired ones request MRT interrupt,
+channels which are not simulated only keep their phase */
+static void timer_advance (ticks_t elapsed)
+{
+	host_timer_t* timer;
+	uint8_t ch;
+
+	for (ch = 0; ch < HAL_TIMER_CHANNELS; ch++)
+	{
+		timer = &host_peripherals.timer[ch];
+		if (!timer->running)
+		{
+			continue;
+		}
+
+		if (timer->value > elapsed)
+		{
+			timer->value -= elapsed;
+			continue;
+		}
+
+		if (!timer_simulated(ch))
+		{
+			if (timer->mode == HAL_TIMER_REPEAT)
+			{
+				timer->value = timer->interval - (uint32_t)((elapsed - timer->value) % timer->interval);
+			}
+			else
+			{
+				timer->value = 0;
+				timer->running = FALSE;
+			}
+			continue;
+		}
+
+		if (timer->enabled)
+		{
+			host_peripherals.timer_pending |= HAL_TIMER_FLAG(ch);
+			host_peripherals.irq_pending[HAL_IRQ_MRT] = TRUE;
+		}
+
+		if (timer->mode == HAL_TIMER_REPEAT)
+		{
+			timer->value = timer->interval;
+		}
+		else
+		{
+			timer->value = 0;
+			timer->running = FALSE;
+		}
+	}
+}
+
+static void apply_event (event_t* event)
+{
+	switch (event->type)
+	{
+		case EV_PRESS:
+			host_set_input(event->pin, FALSE); /* buttons are active low */
+			break;
+		case EV_RELEASE:
+			host_set_input(event->pin, TRUE);
+			break;
+		case EV_UART:
+			host_uart_receive(event->data, event->bytes);
+			break;
+		case EV_DUMP:
+			dump();
+			break;
+		default:
+			break;
+	}
+}
+
+int main (int argc, char** argv)
+{
+	FILE* script = stdin;
+	char line[LINE_SIZE];
+	event_t event;
+	bool event_ready = FALSE;
+	bool script_done = FALSE;
+	ticks_t duration = 0;
+	ticks_t systick_period;
+	ticks_t next_systick;
+	ticks_t next;
+	ticks_t timer;
+	ticks_t elapsed;
+	unsigned line_num = 0;
+	int i;
+
+	for (i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "-n") == 0)
+		{
+			no_display = TRUE;
+		}
+		else if ((strcmp(argv[i], "-g") == 0) && (i + 1 < argc))
+		{
+			gpio_trace = fopen(argv[++i], "w");
+			if (gpio_trace == NULL)
+			{
+				perror(argv[i]);
+				return 1;
+			}
+		}
+		else if ((strcmp(argv[i], "-t") == 0) && (i + 1 < argc))
+		{
+			snprintf(line, sizeof(line), "%s dump", argv[++i]);
+			if (!parse_line(line, &event))
+			{
+				fprintf(stderr, "wrong duration %s\n", argv[i]);
+				return 1;
+			}
+			duration = event.time;
+		}
+		else if (argv[i][0] != '-')
+		{
+			script = fopen(argv[i], "r");
+			if (script == NULL)
+			{
+				perror(argv[i]);
+				return 1;
+			}
+		}
+		else
+		{
+			fprintf(stderr, "usage: %s [-n] [-g gpio_trace] [-t duration] [script]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	host_peripherals.uart_transmit = uart_transmit;
+	if (gpio_trace != NULL)
+	{
+		host_peripherals.gpio_changed = gpio_changed;
+	}
+	host_set_input(SW1, TRUE);
+	host_set_input(SW2, TRUE);
+
+	nixie_init();
+	systick_period = (ticks_t)host_peripherals.systick_load * (HOST_CLOCK_RATE / hal_systick_rate());
+	next_systick = systick_period;
+
+	while (TRUE)
+	{
+		/* read next scripted event */
+		while (!event_ready && !script_done)
+		{
+			if (fgets(line, sizeof(line), script) == NULL)
+			{
+				script_done = TRUE;
+				if (duration == 0)
+				{
+					duration = now;
+				}
+			}
+			else
+			{
+				line_num++;
+				if (!parse_line(line, &event))
+				{
+					fprintf(stderr, "line %u: syntax error\n", line_num);
+					return 1;
+				}
+				if (event.type != EV_NONE)
+				{
+					if (event.time < now)
+					{
+						fprintf(stderr, "line %u: events must be in time order\n", line_num);
+						return 1;
+					}
+					event_ready = TRUE;
+					if ((duration != 0) && (event.time > duration))
+					{
+						duration = event.time;
+					}
+				}
+			}
+		}
+
+		/* next event in virtual time */
+		next = next_systick;
+		clock_phase %= host_peripherals.clock_divider; /* divider changed, partial tick dropped */
+		timer = timer_next();
+		if (timer != 0)
+		{
+			timer = timer * host_peripherals.clock_divider - clock_phase;
+			if ((now + timer) < next)
+			{
+				next = now + timer;
+			}
+		}
+		if (event_ready && (event.time < next))
+		{
+			next = event.time;
+		}
+		if (script_done && !event_ready && (next > duration))
+		{
+			break;
+		}
+
+		elapsed = system_ticks(next - now);
+		timer_advance(elapsed);
+		now = next;
+		host_peripherals.timestamp += (uint32_t)elapsed; /* SCT counts system clock cycles */
+
+		if (event_ready && (event.time == now))
+		{
+			apply_event(&event);
+			event_ready = FALSE;
+		}
+
+		dispatch_interrupts();
+
+		/* SysTick has the lowest priority, PendSV of the same level was dispatched before */
+		if (now == next_systick)
+		{
+			SysTick_Handler();
+			next_systick += systick_period;
+			dispatch_interrupts();
+		}
+
+		nixie_loop();
+		dispatch_interrupts();
+		watchdog_check();
+	}
+
+	dump();
+
+	if (gpio_trace != NULL)
+	{
+		fclose(gpio_trace);
+	}
+
+	return 0;
+}
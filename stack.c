@@ -0,0 +1,22 @@
+#include "stack.h"
+
+/* Reserved stack in bytes */
+uint16_t stack_size (void)
+{
+	return (hal_stack_top() - hal_stack_bottom()) * sizeof(uint32_t);
+}
+
+/* Maximal depth since reset in bytes, scan from the bottom stops at the first used word.
+A word pushed with the value of pattern makes the result smaller by 4 bytes at most */
+uint16_t stack_used (void)
+{
+	uint32_t* word;
+	
+	word = hal_stack_bottom();
+	while ((word < hal_stack_top()) && (*word == HAL_STACK_PAINT))
+	{
+		word++;
+	}
+	
+	return (hal_stack_top() - word) * sizeof(uint32_t);
+}
@@ -0,0 +1,13 @@
+#ifndef STACK_H
+#define STACK_H
+
+/* Stack high-water mark. Startup code paints the whole stack with HAL_STACK_PAINT,
+the deepest nesting of main loop and interrupts since reset overwrites the pattern
+from the top, so the lowest changed word gives the maximal depth */
+
+#include "hal.h"
+
+uint16_t stack_size (void);
+uint16_t stack_used (void);
+
+#endif /* STACK_H */
@@ -0,0 +1,334 @@
+/* Static worst-case stack depth of the firmware, host program (README.md).
+
+Reads call graphs with frame sizes written by GCC with -fcallgraph-info=su (.ci files of GCC build
+with STACK_USAGE on), computes the deepest call chain of main and of each interrupt handler and
+adds them up by priority levels: a handler is preempted only by higher priority levels, each
+level adds its deepest handler and the exception frame. Functions without a frame size (C library,
+assembly) count as 0 and are listed, as are recursion and calls through pointers.
+
+Usage: stack_usage [-s stack_bytes] file.ci... */
+
+#include <stdio.h>
+#include <string.h>
+
+#define MAX_FUNCTIONS 1024
+#define MAX_CALLS 4096
+#define MAX_NAME 128
+#define MAX_LINE 1024
+
+#define DEFAULT_STACK 1024 /* Stack_Size of LPC812_flash.scf */
+#define EXCEPTION_FRAME 36 /* 8 registers stacked by Cortex-M0+ and alignment word */
+
+#define UNKNOWN_DEPTH -1
+#define IN_PROGRESS -2
+
+typedef struct function {
+	char name[MAX_NAME];
+	int frame; /* bytes, -1 if unknown */
+	int dynamic; /* alloca or variable length arrays */
+	int depth; /* frame and the deepest callee, UNKNOWN_DEPTH until computed */
+	int deepest; /* index of the deepest callee, -1 for leaf */
+} function_t;
+
+typedef struct call {
+	int caller;
+	int callee;
+} call_t;
+
+/* Interrupt handlers of the firmware and their NVIC priority (0 is the highest),
+keep in sync with priority plan of nixie.c (PRIO_...) */
+typedef struct handler {
+	const char* name;
+	int priority;
+} handler_t;
+
+static const handler_t handlers[] = {
+	{"MRT_IRQHandler", 0},
+	{"PININT0_IRQHandler", 1},
+	{"PININT1_IRQHandler", 1},
+	{"PININT3_IRQHandler", 1},
+	{"UART0_IRQHandler", 1},
+	{"SysTick_Handler", 3},
+	{"PendSV_Handler", 3}
+};
+
+#define HANDLERS_NUM (sizeof(handlers) / sizeof(handlers[0]))
+#define PRIORITY_LEVELS 4 /* __NVIC_PRIO_BITS of Cortex-M0+ is 2 */
+
+static function_t functions[MAX_FUNCTIONS];
+static int functions_num;
+static call_t calls[MAX_CALLS];
+static int calls_num;
+static int recursion;
+
+static int find_function (const char* name, int create);
+static int parse_field (const char* line, const char* field, char* value);
+static void parse_file (FILE* file);
+static int depth (int index);
+static void print_chain (int index);
+
+
+int main (int argc, char** argv)
+{
+	int stack = DEFAULT_STACK;
+	int arg = 1;
+	int i;
+	int index;
+	int level_depth[PRIORITY_LEVELS];
+	int level_handler[PRIORITY_LEVELS];
+	int total;
+	FILE* file;
+
+	if ((argc > 2) && (strcmp(argv[1], "-s") == 0))
+	{
+		sscanf(argv[2], "%d", &stack);
+		arg = 3;
+	}
+	if (arg >= argc)
+	{
+		fprintf(stderr, "usage: %s [-s stack_bytes] file.ci...\n", argv[0]);
+		return 1;
+	}
+
+	for (; arg < argc; arg++)
+	{
+		file = fopen(argv[arg], "r");
+		if (file == NULL)
+		{
+			fprintf(stderr, "cannot open %s\n", argv[arg]);
+			return 1;
+		}
+		parse_file(file);
+		fclose(file);
+	}
+
+	/* main loop */
+	index = find_function("main", 0);
+	if (index < 0)
+	{
+		fprintf(stderr, "main not found\n");
+		return 1;
+	}
+	total = depth(index);
+	printf("main: %d B\n", total);
+	print_chain(index);
+
+	/* the deepest handler of each priority level */
+	for (i = 0; i < PRIORITY_LEVELS; i++)
+	{
+		level_depth[i] = 0;
+		level_handler[i] = -1;
+	}
+	for (i = 0; i < (int)HANDLERS_NUM; i++)
+	{
+		index = find_function(handlers[i].name, 0);
+		if (index < 0)
+		{
+			printf("%s: not found\n", handlers[i].name);
+			continue;
+		}
+		printf("%s (priority %d): %d B + %d B exception frame\n", handlers[i].name,
+			handlers[i].priority, depth(index), EXCEPTION_FRAME);
+		print_chain(index);
+		if ((depth(index) + EXCEPTION_FRAME) > level_depth[handlers[i].priority])
+		{
+			level_depth[handlers[i].priority] = depth(index) + EXCEPTION_FRAME;
+			level_handler[handlers[i].priority] = index;
+		}
+	}
+
+	/* main preempted by the deepest handler of every level, from the lowest priority */
+	printf("\nworst case nesting:\n  main %d B\n", functions[find_function("main", 0)].depth);
+	for (i = PRIORITY_LEVELS - 1; i >= 0; i--)
+	{
+		if (level_handler[i] >= 0)
+		{
+			total += level_depth[i];
+			printf("  priority %d: %s %d B, total %d B\n", i, functions[level_handler[i]].name,
+				level_depth[i], total);
+		}
+	}
+	printf("%d B of %d B stack (%d B free)\n", total, stack, stack - total);
+
+	/* what the result does not include */
+	for (i = 0; i < functions_num; i++)
+	{
+		if (strcmp(functions[i].name, "__indirect_call") == 0)
+		{
+			printf("warning: calls through pointers are not followed\n");
+		}
+		else if (functions[i].frame < 0)
+		{
+			printf("warning: frame size of %s unknown, counted as 0\n", functions[i].name);
+		}
+		else if (functions[i].dynamic)
+		{
+			printf("warning: %s has dynamic frame\n", functions[i].name);
+		}
+	}
+	if (recursion)
+	{
+		printf("warning: recursion, depth is not bounded\n");
+	}
+
+	return (total > stack) ? 2 : 0;
+}
+
+/* Index of function, new entry if create is set, -1 if not found or the table is full */
+static int find_function (const char* name, int create)
+{
+	int i;
+
+	for (i = 0; i < functions_num; i++)
+	{
+		if (strcmp(functions[i].name, name) == 0)
+		{
+			return i;
+		}
+	}
+	if (!create || (functions_num >= MAX_FUNCTIONS))
+	{
+		return -1;
+	}
+
+	strncpy(functions[functions_num].name, name, MAX_NAME - 1);
+	functions[functions_num].frame = -1;
+	functions[functions_num].dynamic = 0;
+	functions[functions_num].depth = UNKNOWN_DEPTH;
+	functions[functions_num].deepest = -1;
+
+	return functions_num++;
+}
+
+/* Quoted value of field (e.g. title: "main"), 0 if line has no such field */
+static int parse_field (const char* line, const char* field, char* value)
+{
+	const char* start;
+	const char* end;
+	int length;
+
+	start = strstr(line, field);
+	if (start == NULL)
+	{
+		return 0;
+	}
+	start = strchr(start, '"');
+	if (start == NULL)
+	{
+		return 0;
+	}
+	start++;
+	end = strchr(start, '"');
+	if (end == NULL)
+	{
+		return 0;
+	}
+
+	length = end - start;
+	if (length >= MAX_LINE)
+	{
+		length = MAX_LINE - 1;
+	}
+	memcpy(value, start, length);
+	value[length] = '\0';
+
+	return 1;
+}
+
+/* VCG graph of one translation unit:
+node: { title: "name" label: "name\nfile:line:column\n16 bytes (static)" }
+edge: { sourcename: "caller" targetname: "callee" label: "file:line:column" } */
+static void parse_file (FILE* file)
+{
+	char line[MAX_LINE];
+	char name[MAX_LINE];
+	char label[MAX_LINE];
+	char* size;
+	int index;
+	int callee;
+	int frame;
+
+	while (fgets(line, sizeof(line), file) != NULL)
+	{
+		if ((strncmp(line, "node:", 5) == 0) && parse_field(line, "title:", name) && parse_field(line, "label:", label))
+		{
+			index = find_function(name, 1);
+			size = strstr(label, " bytes (");
+			if ((index >= 0) && (size != NULL))
+			{
+				/* number before " bytes", the last line of label */
+				while ((size > label) && (size[-1] >= '0') && (size[-1] <= '9'))
+				{
+					size--;
+				}
+				if (sscanf(size, "%d", &frame) == 1)
+				{
+					/* the same static inline function may come from more files */
+					if (frame > functions[index].frame)
+					{
+						functions[index].frame = frame;
+					}
+					if (strstr(size, "dynamic") != NULL)
+					{
+						functions[index].dynamic = 1;
+					}
+				}
+			}
+		}
+		else if ((strncmp(line, "edge:", 5) == 0) && parse_field(line, "sourcename:", name) && parse_field(line, "targetname:", label))
+		{
+			index = find_function(name, 1);
+			callee = find_function(label, 1);
+			if ((index >= 0) && (callee >= 0) && (calls_num < MAX_CALLS))
+			{
+				calls[calls_num].caller = index;
+				calls[calls_num].callee = callee;
+				calls_num++;
+			}
+		}
+	}
+}
+
+/* Frame of function and its deepest callee, recursion is cut at the repeated function */
+static int depth (int index)
+{
+	int i;
+	int callee_depth;
+	int max = 0;
+
+	if (functions[index].depth == IN_PROGRESS)
+	{
+		recursion = 1;
+		return 0;
+	}
+	if (functions[index].depth != UNKNOWN_DEPTH)
+	{
+		return functions[index].depth;
+	}
+
+	functions[index].depth = IN_PROGRESS;
+	for (i = 0; i < calls_num; i++)
+	{
+		if (calls[i].caller == index)
+		{
+			callee_depth = depth(calls[i].callee);
+			if (callee_depth > max)
+			{
+				max = callee_depth;
+				functions[index].deepest = calls[i].callee;
+			}
+		}
+	}
+	functions[index].depth = max + ((functions[index].frame > 0) ? functions[index].frame : 0);
+
+	return functions[index].depth;
+}
+
+static void print_chain (int index)
+{
+	while (index >= 0)
+	{
+		printf("    %-40s %4d B\n", functions[index].name, (functions[index].frame > 0) ? functions[index].frame : 0);
+		index = functions[index].deepest;
+	}
+}
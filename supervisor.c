@@ -0,0 +1,138 @@
+#include "supervisor.h"
+#include "clock.h"
+
+#define SUPERVISOR_VALID 0x57445447 /* "WDTG" */
+
+/* Watchdog oscillator is accurate to +-40 %, timeout is fed once per second by SysTick.
+Feeding sooner than WATCHDOG_WINDOW after the previous feed resets as well */
+#define WATCHDOG_TIMEOUT 3000 /* ms */
+#define WATCHDOG_WINDOW 250 /* ms */
+
+/* Deadlines of tasks in ms. Main loop and UART parser are checked once per SysTick,
+their deadline leaves a margin for long passes with full UART ring */
+static const uint16_t deadline_ms[SUP_TASKS_NUM] = {
+	10,	/* SUP_DISPLAY, period is 1 ms */
+	2000,	/* SUP_MAIN_LOOP */
+	2000,	/* SUP_UART_PARSER */
+	15000	/* SUP_BT_SETUP, command mode and two settings with 2 s timeouts */
+};
+
+volatile uint32_t supervisor_check_in_time[SUP_TASKS_NUM];
+volatile uint8_t supervisor_armed = 0;
+
+static uint32_t deadline[SUP_TASKS_NUM]; /* in ticks of hal_timestamp */
+static HAL_NOINIT supervisor_record_t record;
+
+static uint8_t late_tasks (void);
+static void deadlines_update (void);
+
+
+/* Evaluate reset cause and start the watchdog, tasks are armed by their first check-in */
+void supervisor_init (void)
+{
+	if (hal_watchdog_reset_cause() && (record.valid == SUPERVISOR_VALID))
+	{
+		record.missed = record.late;
+		record.resets++;
+	}
+	else
+	{
+		record.valid = SUPERVISOR_VALID;
+		record.missed = 0;
+		record.resets = 0;
+	}
+	record.late = 0;
+	
+	deadlines_update();
+	clock_register(deadlines_update);
+	
+	hal_watchdog_init(WATCHDOG_TIMEOUT, WATCHDOG_WINDOW);
+}
+
+/* Timestamps count system clock, deadlines follow its rate (clock manager) */
+static void deadlines_update (void)
+{
+	uint8_t task;
+	
+	for (task = 0; task < SUP_TASKS_NUM; task++)
+	{
+		deadline[task] = deadline_ms[task] * (hal_clock_rate() / 1000);
+	}
+}
+
+void supervisor_stop (supervisor_task_t task)
+{
+	uint32_t irq_state;
+	
+	irq_state = hal_irq_save();
+	supervisor_armed &= ~(1 << task);
+	hal_irq_restore(irq_state);
+}
+
+/* Called by SysTick once per second, late task stops feeding till it checks in again */
+void supervisor_feed (void)
+{
+	record.late = late_tasks();
+	
+	if (record.late == 0)
+	{
+		hal_watchdog_feed();
+	}
+}
+
+/* Tasks late at the last check, bit per supervisor_task_t */
+uint8_t supervisor_late (void)
+{
+	return record.late;
+}
+
+/* Tasks late before the last watchdog reset */
+uint8_t supervisor_missed (void)
+{
+	return record.missed;
+}
+
+uint8_t supervisor_resets (void)
+{
+	return record.resets;
+}
+
+void supervisor_clear (void)
+{
+	record.missed = 0;
+	record.resets = 0;
+}
+
+/* Watchdog warning routed to NMI, runs even when an interrupt handler is stuck
+or interrupts are disabled. Reset follows in a fraction of second */
+void NMI_Handler (void)
+{
+	uint8_t late;
+	
+	hal_watchdog_clear_warning();
+	
+	/* SysTick could be blocked by stuck interrupt, then nothing was recorded yet */
+	late = late_tasks();
+	if (late != 0)
+	{
+		record.late = late;
+	}
+}
+
+static uint8_t late_tasks (void)
+{
+	uint32_t now;
+	uint8_t late = 0;
+	uint8_t task;
+	
+	now = hal_timestamp();
+	for (task = 0; task < SUP_TASKS_NUM; task++)
+	{
+		if ((supervisor_armed & (1 << task)) && ((now - supervisor_check_in_time[task]) > deadline[task]))
+		{
+			late |= 1 << task;
+		}
+	}
+	
+	return late;
+}
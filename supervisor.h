@@ -0,0 +1,52 @@
+#ifndef SUPERVISOR_H
+#define SUPERVISOR_H
+
+/* Watchdog supervisor. Tasks check in periodically, SysTick feeds the windowed watchdog
+only when every armed task checked in within its deadline. A task is armed by its first
+check-in and disarmed by supervisor_stop. When the watchdog is not fed, its warning (NMI)
+stores the late tasks into RAM which is not initialized at reset, they are reported
+after the reset (GET|WATCHDOG of UART) */
+
+#include "hal.h"
+
+typedef enum {
+	SUP_DISPLAY,		/* multiplexing period, MRT channel 0 */
+	SUP_MAIN_LOOP,		/* pass of nixie_loop */
+	SUP_UART_PARSER,	/* UART_commands_exec */
+	SUP_BT_SETUP,		/* whole setup of Bluetooth module after reset (BOARD_BT_RN42) */
+	SUP_TASKS_NUM /* Do not change */
+} supervisor_task_t;
+
+/* Survives watchdog reset, cleared at other resets */
+typedef struct supervisor_record {
+	uint32_t valid; /* SUPERVISOR_VALID, RAM content is random after power-on */
+	uint8_t late; /* tasks late at the last check, bit per task */
+	uint8_t missed; /* tasks late before the last watchdog reset */
+	uint8_t resets; /* watchdog resets since power-on */
+} supervisor_record_t;
+
+extern volatile uint32_t supervisor_check_in_time[SUP_TASKS_NUM];
+extern volatile uint8_t supervisor_armed;
+
+/* Cheap enough for the display interrupt, armed bits are changed with interrupts disabled
+as main loop and MRT interrupt update them both */
+STATIC INLINE void supervisor_check_in (supervisor_task_t task)
+{
+	uint32_t irq_state;
+	
+	supervisor_check_in_time[task] = hal_timestamp();
+	irq_state = hal_irq_save();
+	supervisor_armed |= 1 << task;
+	hal_irq_restore(irq_state);
+}
+
+void NMI_Handler (void); /* watchdog warning */
+void supervisor_init (void);
+void supervisor_stop (supervisor_task_t task);
+void supervisor_feed (void);
+uint8_t supervisor_late (void);
+uint8_t supervisor_missed (void);
+uint8_t supervisor_resets (void);
+void supervisor_clear (void);
+
+#endif /* SUPERVISOR_H */
@@ -0,0 +1,102 @@
+#include "timer.h"
+#include "clock.h"
+
+timer_slot_t timer_slots[TIMER_ROLES_NUM];
+static uint8_t channels_used = 0; /* bit per channel */
+static uint8_t conflicts = 0; /* failed allocations, saturated */
+
+static void timer_clock_changed (void);
+
+
+/* All channels stopped and free, reloads follow clock changes from now */
+void timer_init (void)
+{
+	uint8_t role;
+
+	hal_timer_init();
+
+	for (role = 0; role < TIMER_ROLES_NUM; role++)
+	{
+		timer_slots[role].flag = 0;
+		timer_slots[role].reload = 0;
+		timer_slots[role].rate = 0;
+		timer_slots[role].channel = TIMER_NONE;
+		timer_slots[role].fixed = FALSE;
+	}
+	channels_used = 0;
+	conflicts = 0;
+
+	clock_register(timer_clock_changed);
+}
+
+/* The lowest free channel gets the role and its mode, it stays stopped till timer_start.
+FALSE if the role has a channel already or none is free */
+bool timer_alloc (timer_role_t role, hal_timer_mode_t mode, uint32_t rate)
+{
+	timer_slot_t* slot;
+	uint8_t ch;
+
+	for (ch = 0; ch < HAL_TIMER_CHANNELS; ch++)
+	{
+		if (!(channels_used & (1 << ch)))
+		{
+			break;
+		}
+	}
+
+	if ((role >= TIMER_ROLES_NUM) || (timer_slots[role].channel != TIMER_NONE) || (ch >= HAL_TIMER_CHANNELS) || (rate == 0))
+	{
+		if (conflicts < 0xFF)
+		{
+			conflicts++;
+		}
+		return FALSE;
+	}
+
+	slot = &timer_slots[role];
+	slot->rate = rate;
+	slot->reload = hal_clock_rate() / rate;
+	slot->mode = mode;
+	slot->fixed = FALSE;
+	slot->flag = HAL_TIMER_FLAG(ch);
+	slot->channel = ch;
+	channels_used |= 1 << ch;
+
+	hal_timer_config(ch, mode);
+
+	return TRUE;
+}
+
+/* Bit per allocated channel */
+uint8_t timer_usage (void)
+{
+	return channels_used;
+}
+
+uint8_t timer_conflicts (void)
+{
+	return conflicts;
+}
+
+/* Clock manager changed the rate, HAL converted running periods and repeated roles running at
+their rate get the exact reload from the next period (interrupts are disabled) */
+static void timer_clock_changed (void)
+{
+	timer_slot_t* slot;
+	uint8_t role;
+
+	for (role = 0; role < TIMER_ROLES_NUM; role++)
+	{
+		slot = &timer_slots[role];
+		if (slot->channel == TIMER_NONE)
+		{
+			continue;
+		}
+
+		slot->reload = hal_clock_rate() / slot->rate;
+		if ((slot->mode == HAL_TIMER_REPEAT) && slot->fixed && hal_timer_running(slot->channel))
+		{
+			hal_timer_set_interval(slot->channel, slot->reload);
+		}
+	}
+}
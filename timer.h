@@ -0,0 +1,88 @@
+#ifndef TIMER_H
+#define TIMER_H
+
+/* Timer service - channels of multi-rate timer are allocated by role instead of fixed numbers.
+Each role keeps its rate and reload value in ticks of the current clock, reloads are recomputed
+only when the clock manager changes the rate, so start, stop and rearm are single writes of the
+channel interval. Allocation of a role twice or with all channels taken fails and is counted,
+7D 2C <role> 00 00 00 reports it (README.md) */
+
+#include "hal.h"
+
+#define TIMER_NONE 0xFF /* channel of role not allocated */
+
+typedef enum {
+	TIMER_REFRESH,	/* repeat - base period of multiplexing */
+	TIMER_BLANK,	/* one-shot - blanking, cathode and crossfade phases of a slot */
+	TIMER_SETTING,	/* repeat - set mode entry and repeated increment */
+	TIMER_ROLL,		/* repeat - frame rate of transitions */
+	TIMER_ROLES_NUM /* Do not change */
+} timer_role_t;
+
+typedef struct timer_slot {
+	uint32_t flag;		/* HAL_TIMER_FLAG of channel, 0 if not allocated */
+	uint32_t reload;	/* period of rate in ticks of current clock */
+	uint32_t rate;		/* Hz */
+	hal_timer_mode_t mode;
+	uint8_t channel;	/* TIMER_NONE if not allocated */
+	bool fixed;			/* runs at reload, kept exact across clock changes */
+} timer_slot_t;
+
+extern timer_slot_t timer_slots[TIMER_ROLES_NUM];
+
+void timer_init (void);
+bool timer_alloc (timer_role_t role, hal_timer_mode_t mode, uint32_t rate);
+uint8_t timer_usage (void);
+uint8_t timer_conflicts (void);
+
+/* Calls below take an allocated role */
+
+STATIC INLINE uint8_t timer_channel (timer_role_t role)
+{
+	return timer_slots[role].channel;
+}
+
+/* role expired, int_pend is the result of hal_timer_pending */
+STATIC INLINE bool timer_expired (uint32_t int_pend, timer_role_t role)
+{
+	return (int_pend & timer_slots[role].flag) != 0;
+}
+
+/* new period at rate of role from now */
+STATIC INLINE void timer_start (timer_role_t role)
+{
+	timer_slots[role].fixed = TRUE;
+	hal_timer_restart(timer_slots[role].channel, timer_slots[role].reload);
+}
+
+/* new period of given ticks from now, repeated ones keep it */
+STATIC INLINE void timer_rearm (timer_role_t role, uint32_t ticks)
+{
+	timer_slots[role].fixed = FALSE;
+	hal_timer_restart(timer_slots[role].channel, ticks);
+}
+
+STATIC INLINE void timer_stop (timer_role_t role)
+{
+	hal_timer_restart(timer_slots[role].channel, 0);
+}
+
+/* period of repeated role from the next one */
+STATIC INLINE void timer_set_interval (timer_role_t role, uint32_t ticks)
+{
+	timer_slots[role].fixed = FALSE;
+	hal_timer_set_interval(timer_slots[role].channel, ticks);
+}
+
+STATIC INLINE uint32_t timer_interval (timer_role_t role)
+{
+	return hal_timer_get_interval(timer_slots[role].channel);
+}
+
+/* remaining ticks of current period */
+STATIC INLINE uint32_t timer_value (timer_role_t role)
+{
+	return hal_timer_value(timer_slots[role].channel);
+}
+
+#endif /* TIMER_H */
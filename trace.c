@@ -0,0 +1,51 @@
+#include "trace.h"
+
+volatile trace_buffer_t trace_buffer;
+volatile uint8_t trace_mask = TRACE_STATE;
+
+/* Start timestamp counter and clear the ring, before interrupts are enabled */
+void trace_init (void)
+{
+	hal_timestamp_init();
+	trace_buffer.head = 0;
+	
+#ifdef TRACE_EVENT_RECORDER
+	EventRecorderInitialize(EventRecordAll, 1);
+#endif
+}
+
+/* New mask clears the ring, so the dump contains only enabled events */
+void trace_set_mask (uint8_t mask)
+{
+	uint32_t irq_state;
+	
+	irq_state = hal_irq_save();
+	trace_mask = mask;
+	trace_buffer.head = 0;
+	hal_irq_restore(irq_state);
+}
+
+/* Record with index counted from the oldest one, FALSE if there is no such record */
+bool trace_get (uint8_t index, trace_record_t* record)
+{
+	uint32_t head;
+	uint32_t oldest;
+	uint32_t irq_state;
+	
+	irq_state = hal_irq_save();
+	head = trace_buffer.head;
+	oldest = (head > TRACE_SIZE) ? (head - TRACE_SIZE) : 0;
+	
+	if ((oldest + index) >= head)
+	{
+		hal_irq_restore(irq_state);
+		return FALSE;
+	}
+	
+	record->time = trace_buffer.records[(oldest + index) & (TRACE_SIZE - 1)].time;
+	record->event = trace_buffer.records[(oldest + index) & (TRACE_SIZE - 1)].event;
+	record->data = trace_buffer.records[(oldest + index) & (TRACE_SIZE - 1)].data;
+	hal_irq_restore(irq_state);
+	
+	return TRUE;
+}
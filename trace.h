@@ -0,0 +1,84 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+/* Trace of interrupts and state changes into RAM ring (trace_buffer, readable by debugger),
+dumped over UART (GET|TRACE_LOG) and decoded on PC by trace_decode.c. Each record has
+a timestamp of free-running 32-bit SCT counter in system clock cycles. With TRACE_EVENT_RECORDER
+defined (Event Recorder component added to the project) records go to Event Recorder too,
+event names are in EventRecorderStub.scvd */
+
+#include "hal.h"
+
+#define TRACE_SIZE 32 /* records, power of 2 */
+
+/* classes of events, enabled by trace_mask */
+#define TRACE_ISR 0x01 /* enter/exit of interrupts, fills the ring in few ms */
+#define TRACE_STATE 0x02 /* set mode, displayed data, UART frames, lost work, clock changes */
+
+/* events, ids of Event Recorder (Do not change numbers) */
+#define TR_NONE 0x00 /* no record with given index */
+#define TR_MRT_ENTER 0x01
+#define TR_MRT_EXIT 0x02
+#define TR_SYSTICK_ENTER 0x03
+#define TR_SYSTICK_EXIT 0x04
+#define TR_PININT_ENTER 0x05 /* data: channel */
+#define TR_PININT_EXIT 0x06
+#define TR_UART_ENTER 0x07
+#define TR_UART_EXIT 0x08
+#define TR_PENDSV_ENTER 0x09
+#define TR_PENDSV_EXIT 0x0A
+#define TR_SET_MODE 0x10 /* data: new set_mode */
+#define TR_DISPLAYED 0x11 /* data: new curr_displayed */
+#define TR_FRAME_OK 0x12 /* data: command */
+#define TR_FRAME_REJECTED 0x13 /* data: command, unknown or out of range */
+#define TR_FRAME_BAD 0x14 /* data: first byte, start flag missing */
+#define TR_WORK_LOST 0x15 /* data: type of deferred work, its queue was full */
+#define TR_CLOCK 0x16 /* data: new divider of system clock, following timestamps count it */
+#define TR_CLOCK_LOST 0x17 /* data: CLOCK_USERS_MAX, user of clock rate not registered */
+
+#define TRACE_COMPONENT 0x00 /* component number of Event Recorder */
+
+typedef struct trace_record {
+	uint32_t time;
+	uint8_t event;
+	uint8_t data;
+} trace_record_t;
+
+typedef struct trace_buffer {
+	trace_record_t records[TRACE_SIZE];
+	uint32_t head; /* records written since trace_init, next index is head % TRACE_SIZE */
+} trace_buffer_t;
+
+extern volatile trace_buffer_t trace_buffer;
+extern volatile uint8_t trace_mask;
+
+#ifdef TRACE_EVENT_RECORDER
+	#include "EventRecorder.h"
+#endif
+
+/* Store one record, safe in any context (interrupts are disabled for few cycles) */
+STATIC INLINE void trace_record (uint8_t event, uint8_t data)
+{
+	volatile trace_record_t* record;
+	uint32_t irq_state;
+	
+	irq_state = hal_irq_save();
+	record = &trace_buffer.records[trace_buffer.head & (TRACE_SIZE - 1)];
+	trace_buffer.head++;
+	record->time = hal_timestamp();
+	record->event = event;
+	record->data = data;
+	hal_irq_restore(irq_state);
+	
+#ifdef TRACE_EVENT_RECORDER
+	EventRecord2(EventID(EventLevelOp, TRACE_COMPONENT, event), data, 0);
+#endif
+}
+
+#define TRACE(class, event, data) do { if (trace_mask & (class)) { trace_record((event), (data)); } } while (0)
+
+void trace_init (void);
+void trace_set_mask (uint8_t mask);
+bool trace_get (uint8_t index, trace_record_t* record);
+
+#endif /* TRACE_H */
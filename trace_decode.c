@@ -0,0 +1,140 @@
+/* Decoder of trace records dumped over UART (see trace.h), host program (README.md).
+
+Reads received bytes as hex text (e.g. log of terminal or of simulator), answers to
+GET|TRACE_LOG (7D 06 <event> <index> <data> 00 followed by 7D 07 <time>) are printed
+as timeline, other bytes are skipped.
+
+Clock is the crystal rate, divider of system clock at the oldest record (CLOCK_IDLE_DIVIDER
+unless UART traffic or set mode went on) is given by -d, TR_CLOCK records change it.
+
+Usage: trace_decode [-c clock_hz] [-d divider] < dump.txt */
+
+#include <stdio.h>
+#include <string.h>
+#include "uart.h"
+#include "trace.h"
+
+#define DEFAULT_CLOCK 18432000ul
+#define MSG_SIZE 6
+
+static const char* const event_names[] = {
+	[TR_NONE] = "none",
+	[TR_MRT_ENTER] = "MRT enter",
+	[TR_MRT_EXIT] = "MRT exit",
+	[TR_SYSTICK_ENTER] = "SysTick enter",
+	[TR_SYSTICK_EXIT] = "SysTick exit",
+	[TR_PININT_ENTER] = "PININT enter",
+	[TR_PININT_EXIT] = "PININT exit",
+	[TR_UART_ENTER] = "UART enter",
+	[TR_UART_EXIT] = "UART exit",
+	[TR_PENDSV_ENTER] = "PendSV enter",
+	[TR_PENDSV_EXIT] = "PendSV exit",
+	[TR_SET_MODE] = "set mode",
+	[TR_DISPLAYED] = "displayed",
+	[TR_FRAME_OK] = "frame ok",
+	[TR_FRAME_REJECTED] = "frame rejected",
+	[TR_FRAME_BAD] = "frame bad",
+	[TR_WORK_LOST] = "work lost",
+	[TR_CLOCK] = "clock divider",
+	[TR_CLOCK_LOST] = "clock user lost"
+};
+
+static const char* event_name (uint8_t event)
+{
+	if ((event < sizeof(event_names) / sizeof(event_names[0])) && (event_names[event] != NULL))
+	{
+		return event_names[event];
+	}
+	return "unknown";
+}
+
+int main (int argc, char** argv)
+{
+	unsigned long clock = DEFAULT_CLOCK;
+	uint8_t msg[MSG_SIZE];
+	uint8_t event_msg[MSG_SIZE] = {0}; /* read only after a 7D 06 frame filled it */
+	bool event_ready = FALSE;
+	bool first = TRUE;
+	uint32_t time;
+	uint32_t previous = 0;
+	unsigned long divider = 1; /* of system clock, changed by TR_CLOCK records */
+	double elapsed = 0; /* us since the first record */
+	double delta;
+	char token[64];
+	unsigned byte;
+	int length;
+	int fill = 0;
+	int i;
+
+	for (i = 1; i < argc; i++)
+	{
+		if ((strcmp(argv[i], "-c") == 0) && (i + 1 < argc))
+		{
+			sscanf(argv[++i], "%lu", &clock);
+		}
+		else if ((strcmp(argv[i], "-d") == 0) && (i + 1 < argc))
+		{
+			sscanf(argv[++i], "%lu", &divider);
+		}
+		else
+		{
+			fprintf(stderr, "usage: %s [-c clock_hz] [-d divider] < dump.txt\n", argv[0]);
+			return 1;
+		}
+	}
+
+	printf("%12s %10s  %-16s %s\n", "time [us]", "delta [us]", "event", "data");
+
+	while (scanf("%63s", token) == 1)
+	{
+		if ((strlen(token) != 2) || (sscanf(token, "%2x%n", &byte, &length) != 1) || (length != 2))
+		{
+			continue;
+		}
+
+		/* synchronize on start flag */
+		if ((fill == 0) && (byte != START_FLAG))
+		{
+			continue;
+		}
+		msg[fill++] = (uint8_t)byte;
+		if (fill < MSG_SIZE)
+		{
+			continue;
+		}
+		fill = 0;
+
+		if (msg[1] == TRACE_LOG)
+		{
+			memcpy(event_msg, msg, MSG_SIZE);
+			event_ready = TRUE;
+		}
+		else if ((msg[1] == TRACE_TIME) && event_ready)
+		{
+			event_ready = FALSE;
+			if (event_msg[2] == TR_NONE)
+			{
+				continue;
+			}
+
+			time = ((uint32_t)msg[2] << 24) | ((uint32_t)msg[3] << 16) | ((uint32_t)msg[4] << 8) | msg[5];
+			if (first)
+			{
+				previous = time;
+				first = FALSE;
+			}
+			/* wraps of counter are unrolled by unsigned difference */
+			delta = (uint32_t)(time - previous) * 1e6 * divider / clock;
+			elapsed += delta;
+
+			printf("%12.1f %10.1f  %-16s 0x%02X\n", elapsed, delta, event_name(event_msg[2]), event_msg[4]);
+			previous = time;
+			if ((event_msg[2] == TR_CLOCK) && (event_msg[4] > 0))
+			{
+				divider = event_msg[4];
+			}
+		}
+	}
+
+	return 0;
+}
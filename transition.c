@@ -0,0 +1,347 @@
+#include "transition.h"
+
+/* Transition is precomputed in main loop and played by PendSV at ROLL_RATE (TIMER_ROLL),
+it only copies the next frame to display. Main loop must not touch transition while it is running */
+static volatile transition_t transition;
+
+static uint8_t crossfade_frames = CROSSFADE_FRAMES;
+static uint8_t display_options = 0; /* DISPLAY_... */
+
+/* effect used for each kind of transition */
+static effect_t effects[TRANSITIONS_NUM] = {
+	EFFECT_SLOT_MACHINE,	/* TO_TIME */
+	EFFECT_SLOT_MACHINE,	/* TO_DATE */
+	EFFECT_SLOT_MACHINE,	/* TO_USER_DATA */
+	EFFECT_NONE						/* VALUE_CHANGE */
+};
+
+static uint8_t get_digit (display_t* display, uint8_t digit);
+static void set_digit (volatile display_t* display, uint8_t digit, uint8_t value);
+
+
+/* Check what has to be displayed and start transition to it if needed (called from main loop
+with copies of time and of displayed digits) */
+void display_update (const time_t* time, volatile display_t* user_data, const display_t* display)
+{
+	static uint8_t shown = TIME; /* data displayed by last transition */
+	static display_t shown_digits; /* digits displayed by last transition */
+
+	display_t needed;
+	display_t from;
+	uint8_t displayed;
+	transition_kind_t kind;
+
+	if (transition.running)
+	{
+		return;
+	}
+
+	displayed = time->curr_displayed & ~LOCK; /* mask LOCK since we don't care */
+
+	switch (displayed)
+	{
+		case DATE:
+			needed.seconds = to_BCD(year_to_number(time->years));
+			needed.minutes = to_BCD(time->months);
+			needed.hours = to_BCD(time->days);
+			kind = TO_DATE;
+			break;
+
+		case USER_DATA:
+			needed.seconds = to_BCD(user_data->seconds);
+			needed.minutes = to_BCD(user_data->minutes);
+			needed.hours = to_BCD(user_data->hours);
+			kind = TO_USER_DATA;
+			break;
+
+		default:
+			needed.seconds = TIME_DIGITS(time->seconds);
+			needed.minutes = TIME_DIGITS(time->minutes);
+			needed.hours = TIME_DIGITS(time->hours);
+			kind = TO_TIME;
+			break;
+	}
+	needed.pad = 0;
+	display_blank(&needed, displayed);
+
+	if ((displayed == shown) && !(time->curr_displayed & LOCK))
+	{
+		if ((needed.seconds == shown_digits.seconds) &&
+			(needed.minutes == shown_digits.minutes) &&
+			(needed.hours == shown_digits.hours))
+		{
+			return; /* nothing changed */
+		}
+
+		if (displayed != USER_DATA) /* new user data are shown with the same effect as switching to them */
+		{
+			kind = VALUE_CHANGE;
+		}
+	}
+
+	from.seconds = display->seconds;
+	from.minutes = display->minutes;
+	from.hours = display->hours;
+	from.pad = 0;
+
+	shown = displayed;
+	shown_digits = needed;
+
+	transition_start(from, needed, effects[kind]);
+}
+
+/* Digits hidden by display options become BLANK_DIGIT. Time and date blank only the tens
+of hours and days, user data are a number and blank leading zeros down to the last digit */
+void display_blank (display_t* digits, uint8_t displayed)
+{
+	uint8_t digit;
+	uint8_t value;
+	uint8_t last;
+
+	if ((displayed == TIME) && (display_options & DISPLAY_HHMM))
+	{
+		digits->seconds = (BLANK_DIGIT << 4) | BLANK_DIGIT;
+	}
+
+	if (display_options & DISPLAY_NO_LEADING_ZERO)
+	{
+		last = (displayed == USER_DATA) ? 1 : 5;
+		for (digit = 5; digit >= last; digit--)
+		{
+			value = get_digit(digits, digit);
+			if ((value != 0) && (value != BLANK_DIGIT))
+			{
+				break;
+			}
+			set_digit(digits, digit, BLANK_DIGIT);
+		}
+	}
+}
+
+/* FALSE for unknown option bits, displayed digits are recomputed by the caller */
+bool display_set_options (uint8_t options)
+{
+	if (options & ~DISPLAY_OPTIONS)
+	{
+		return FALSE;
+	}
+
+	display_options = options;
+
+	return TRUE;
+}
+
+uint8_t display_get_options (void)
+{
+	return display_options;
+}
+
+/* Next frame of running transition into frame (called by PendSV at ROLL_RATE),
+old digits and fade level are used by display multiplexing during crossfade.
+FALSE when no transition is running and frame is not changed */
+bool transition_tick (volatile time_t* time, display_frame_t* frame)
+{
+	if (!transition.running)
+	{
+		return FALSE;
+	}
+	
+	frame->fade_from.seconds = transition.fade_from.seconds;
+	frame->fade_from.minutes = transition.fade_from.minutes;
+	frame->fade_from.hours = transition.fade_from.hours;
+	frame->fade_level = transition.fade[transition.next_frame];
+	frame->digits.seconds = transition.frames[transition.next_frame].seconds;
+	frame->digits.minutes = transition.frames[transition.next_frame].minutes;
+	frame->digits.hours = transition.frames[transition.next_frame].hours;
+
+	transition.next_frame++;
+	if (transition.next_frame >= transition.frames_num)
+	{
+		transition.running = FALSE;
+		time->curr_displayed &= ~LOCK; /* unlock */
+	}
+	
+	return TRUE;
+}
+
+/* Precompute frames of transition from -> to, frame i holds digits displayed after i + 1 ticks */
+void transition_start (display_t from, display_t to, effect_t effect)
+{
+	uint8_t delay[6];
+	uint8_t steps[6];
+	uint8_t old_digit[6];
+	uint8_t new_digit[6];
+	uint8_t frames_num = 1;
+	uint8_t digit;
+	uint8_t frame;
+	uint8_t value;
+
+	for (digit = 0; digit < 6; digit++)
+	{
+		old_digit[digit] = get_digit(&from, digit);
+		new_digit[digit] = get_digit(&to, digit);
+		delay[digit] = 0;
+
+		/* blank digit rolls like 0 and rolling to blank digit ends after all 10 numbers */
+		if (old_digit[digit] > 9)
+		{
+			old_digit[digit] = 0;
+		}
+		if (new_digit[digit] > 9)
+		{
+			steps[digit] = 0;
+		}
+		else
+		{
+			steps[digit] = wrap_value(new_digit[digit] - old_digit[digit], 0, 9);
+		}
+
+		switch (effect)
+		{
+			case EFFECT_CASCADE:
+				delay[digit] = (5 - digit) * CASCADE_DELAY; /* digit 5 is the leftmost one */
+				steps[digit] += 10; /* to roll over all 10 (0-9) digits */
+				break;
+			case EFFECT_SLOT_MACHINE:
+				steps[digit] += 10;
+				break;
+			case EFFECT_CHANGED_ONLY:
+				break;
+			case EFFECT_CROSSFADE:
+				steps[digit] = (get_digit(&from, digit) != get_digit(&to, digit)) ? crossfade_frames : 0;
+				break;
+			default:
+				steps[digit] = 0;
+				break;
+		}
+
+		if ((delay[digit] + steps[digit]) > frames_num)
+		{
+			frames_num = delay[digit] + steps[digit];
+		}
+	}
+
+	for (frame = 0; frame < frames_num; frame++)
+	{
+		for (digit = 0; digit < 6; digit++)
+		{
+			if ((frame + 1) <= delay[digit]) /* digit not rolling yet */
+			{
+				value = get_digit(&from, digit);
+			}
+			else if ((frame + 1 - delay[digit]) >= steps[digit]) /* digit finished */
+			{
+				value = new_digit[digit];
+			}
+			else if (effect == EFFECT_CROSSFADE)
+			{
+				value = new_digit[digit]; /* old digits are in fade_from */
+			}
+			else
+			{
+				value = (old_digit[digit] + (frame + 1 - delay[digit])) % 10;
+			}
+
+			set_digit(&transition.frames[frame], digit, value);
+		}
+		
+		/* new digits get more and more of on-time, the last frame shows new digits only */
+		if (effect == EFFECT_CROSSFADE)
+		{
+			transition.fade[frame] = ((frame + 1) * FADE_STEPS) / frames_num;
+		}
+		else
+		{
+			transition.fade[frame] = FADE_STEPS;
+		}
+	}
+	
+	transition.fade_from.seconds = from.seconds;
+	transition.fade_from.minutes = from.minutes;
+	transition.fade_from.hours = from.hours;
+
+	transition.frames_num = frames_num;
+	transition.next_frame = 0;
+	transition.running = TRUE;
+}
+
+bool transition_set_effect (transition_kind_t kind, effect_t effect, uint8_t frames)
+{
+	if ((kind >= TRANSITIONS_NUM) || (effect >= EFFECTS_NUM) || (frames > MAX_FRAMES))
+	{
+		return FALSE;
+	}
+
+	effects[kind] = effect;
+
+	if (frames > 0) /* 0 keeps current length of crossfade */
+	{
+		crossfade_frames = frames;
+	}
+
+	return TRUE;
+}
+
+effect_t transition_get_effect (transition_kind_t kind)
+{
+	return effects[kind];
+}
+
+bool transition_running (void)
+{
+	return transition.running;
+}
+
+/* Running transition stops at its current frame, called by PendSV which plays it */
+void transition_cancel (void)
+{
+	transition.running = FALSE;
+}
+
+/* digit 0 is the lower digit of seconds, digit 5 is the upper digit of hours */
+static uint8_t get_digit (display_t* display, uint8_t digit)
+{
+	uint8_t pair;
+
+	switch (digit >> 1)
+	{
+		case 0:
+			pair = display->seconds;
+			break;
+		case 1:
+			pair = display->minutes;
+			break;
+		default:
+			pair = display->hours;
+			break;
+	}
+
+	return (digit & 0x01) ? (pair >> 4) : (pair & 0x0F);
+}
+
+static void set_digit (volatile display_t* display, uint8_t digit, uint8_t value)
+{
+	volatile uint8_t* pair;
+
+	switch (digit >> 1)
+	{
+		case 0:
+			pair = &display->seconds;
+			break;
+		case 1:
+			pair = &display->minutes;
+			break;
+		default:
+			pair = &display->hours;
+			break;
+	}
+
+	if (digit & 0x01)
+	{
+		*pair = (*pair & 0x0F) | (value << 4);
+	}
+	else
+	{
+		*pair = (*pair & 0xF0) | value;
+	}
+}
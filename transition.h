@@ -0,0 +1,62 @@
+#ifndef TRANSITION_H
+#define TRANSITION_H
+
+#include "driver.h"
+
+#define MAX_FRAMES 32 /* longest effect is cascade: 5 * CASCADE_DELAY + 19 frames */
+#define CASCADE_DELAY 2 /* frames between start of rolling of two neighbouring tubes */
+#define CROSSFADE_FRAMES 8 /* default length of crossfade */
+#define FADE_STEPS 16 /* crossfade resolution, 0 = old digits only, FADE_STEPS = new digits only */
+#define BLANK_DIGIT 0x0F /* out of 0-9 range, no cathode is lit */
+
+/* display options, tubes of blank digits are left out of multiplexing */
+#define DISPLAY_HHMM 0x01 /* time without seconds */
+#define DISPLAY_NO_LEADING_ZERO 0x02 /* blank tens of hours and days, leading zeros of user data */
+#define DISPLAY_OPTIONS (DISPLAY_HHMM | DISPLAY_NO_LEADING_ZERO)
+
+typedef enum {
+	EFFECT_NONE, /* new digits are shown in next frame */
+	EFFECT_SLOT_MACHINE, /* all digits roll over all 10 numbers together */
+	EFFECT_CASCADE, /* as slot machine, but tubes start rolling one by one from the left */
+	EFFECT_CHANGED_ONLY, /* only changed digits roll up to the new number */
+	EFFECT_CROSSFADE, /* changed digits fade from old to new number within multiplexing slot */
+	EFFECTS_NUM /* Do not change */
+} effect_t;
+
+typedef enum {
+	TO_TIME,
+	TO_DATE,
+	TO_USER_DATA, /* also new user data while user data are displayed */
+	VALUE_CHANGE, /* displayed data not changed, but their value did (next second) */
+	TRANSITIONS_NUM /* Do not change */
+} transition_kind_t;
+
+/* Everything multiplexing needs to show one moment of a transition */
+typedef struct display_frame {
+	display_t digits;
+	display_t fade_from; /* old digits of crossfade */
+	uint8_t fade_level; /* share of on-time of new digits */
+	uint8_t next_tube[BOARD_TUBES]; /* multiplexing order, lit tube after each tube */
+} display_frame_t;
+
+typedef struct transition {
+	display_t frames[MAX_FRAMES];
+	uint8_t fade[MAX_FRAMES]; /* share of on-time of new digits in frame */
+	display_t fade_from; /* old digits of crossfade */
+	uint8_t frames_num;
+	uint8_t next_frame;
+	bool running;
+} transition_t;
+
+void display_update (const time_t* time, volatile display_t* user_data, const display_t* display);
+void display_blank (display_t* digits, uint8_t displayed);
+bool display_set_options (uint8_t options);
+uint8_t display_get_options (void);
+bool transition_tick (volatile time_t* time, display_frame_t* frame);
+void transition_start (display_t from, display_t to, effect_t effect);
+bool transition_set_effect (transition_kind_t kind, effect_t effect, uint8_t frames);
+effect_t transition_get_effect (transition_kind_t kind);
+bool transition_running (void);
+void transition_cancel (void);
+
+#endif /* TRANSITION_H */
@@ -1,4 +1,13 @@
 #include "uart.h"
+#include "nixie.h"
+#include "transition.h"
+#include "profile.h"
+#include "trace.h"
+#include "stack.h"
+#include "supervisor.h"
+#include "fault.h"
+#include "clock.h"
+#include "timer.h"
 
 //#define BAUD_RATE 115200
 #define BAUD_RATE 57600
@@ -16,6 +25,9 @@ static uint8_t UART_data_RX[UART_RB_SIZE];
 static uint8_t UART_data_TX[UART_RB_SIZE];
 /* Variables to indicate stale RX */
 volatile bool RX_new_data = false;
+static uint16_t stream_frames = 0; /* accepted DISP | STREAM messages, wraps */
+
+static bool display_digits_valid (uint8_t digits);
 
 
 void UART_init (void)
@@ -23,32 +35,22 @@ void UART_init (void)
 	RingBuffer_Init(&rxring, UART_data_RX, 1, UART_RB_SIZE);
 	RingBuffer_Init(&txring, UART_data_TX, 1, UART_RB_SIZE);
 	
-	Chip_Clock_SetUARTClockDiv(1);
-	
-	/* Setup UART */
-	Chip_UART_Init(LPC_USART0);
-	Chip_UART_ConfigData(LPC_USART0, UART_CFG_DATALEN_8 | UART_CFG_PARITY_NONE | UART_CFG_STOPLEN_1 );
-	Chip_Clock_SetUSARTNBaseClockRate((BAUD_RATE * 16), true);
-	Chip_UART_SetBaud(LPC_USART0, BAUD_RATE);
-	Chip_UART_Enable(LPC_USART0);
-	Chip_UART_TXEnable(LPC_USART0);
-	
-	/* Enable receive data and line status interrupt */
-	Chip_UART_IntEnable(LPC_USART0, UART_INTEN_RXRDY);
-	//Chip_UART_IntDisable(LPC_USART0, UART_INTEN_RXRDY);
-	Chip_UART_IntDisable(LPC_USART0, UART_INTEN_TXRDY);	/* May not be needed */
-	
-	NVIC_EnableIRQ(UART0_IRQn);
+	/* Setup UART, enable receive data interrupt */
+	hal_uart_init(BAUD_RATE);
 }
 
 
 void UART0_IRQHandler (void)
 {
-	if((Chip_UART_GetStatus(LPC_USART0) & UART_STAT_RXRDY) != 0)
+	TRACE(TRACE_ISR, TR_UART_ENTER, 0);
+	
+	if(hal_uart_rx_ready())
 	{
 		RX_new_data = true;
 	}
-	Chip_UART_IRQRBHandler(LPC_USART0, &rxring, &txring);
+	hal_uart_irq_handler(&rxring, &txring);
+	
+	TRACE(TRACE_ISR, TR_UART_EXIT, 0);
 }
 
 bool set_BT_power_save (volatile time_t* curr_time)
@@ -65,18 +67,18 @@ bool set_BT_power_save (volatile time_t* curr_time)
 	{
 		case CMD:
 			tx_data = "$$$";
-		  Chip_UART_SendRB(LPC_USART0, &txring, tx_data, 3); /* actual size of tx_data is 4, therefore -1 because we don't want to send null terminator */
+		  hal_uart_send(&txring, tx_data, 3); /* actual size of tx_data is 4, therefore -1 because we don't want to send null terminator */
 			prev_state = state;
 			state = WAIT;
 		break;
 			
 		case WAIT:
-			curr_time_stamp = curr_time->seconds + curr_time->minutes*60 + curr_time->hours*360;
+			curr_time_stamp = TIME_TO_BIN(curr_time->seconds) + TIME_TO_BIN(curr_time->minutes)*60 + TIME_TO_BIN(curr_time->hours)*3600;
 			if (RingBuffer_GetCount(&rxring) == BT_RESP_SIZE)
 			{
-				Chip_UART_IntDisable(LPC_USART0, UART_INTEN_RXRDY); /* disable RX interrupt to protect integrity of rxring buffer during reading */	
-				Chip_UART_ReadRB(LPC_USART0, &rxring, rx_data, BT_RESP_SIZE);
-				Chip_UART_IntEnable(LPC_USART0, UART_INTEN_RXRDY);
+				hal_uart_rx_irq_disable(); /* disable RX interrupt to protect integrity of rxring buffer during reading */	
+				hal_uart_read(&rxring, rx_data, BT_RESP_SIZE);
+				hal_uart_rx_irq_enable();
 				rx_data[BT_RESP_SIZE] = '\0';
 				if ((strcmp(rx_data, "CMD\r\n") == 0) || (strcmp(rx_data, "AOK\r\n") == 0) || (strcmp(rx_data, "END\r\n") == 0))
 				{
@@ -97,21 +99,21 @@ bool set_BT_power_save (volatile time_t* curr_time)
 			
 		case SET_BT_SI:
 			tx_data = "SI,0012\r"; /* set Discover window to the lowest value */
-			Chip_UART_SendRB(LPC_USART0, &txring, tx_data, 8);
+			hal_uart_send(&txring, tx_data, 8);
 			prev_state = state;
 			state = WAIT;
 		break;
 		
 		case SET_BT_SJ:
 			tx_data = "SJ,0012\r"; /* set Connect window to the lowest value */
-			Chip_UART_SendRB(LPC_USART0, &txring, tx_data, 8);
+			hal_uart_send(&txring, tx_data, 8);
 			prev_state = state;
 			state = WAIT;
 		break;
 		
 		case EXIT:
 			tx_data = "---\r\n";
-			Chip_UART_SendRB(LPC_USART0, &txring, tx_data, 5);	
+			hal_uart_send(&txring, tx_data, 5);	
 			prev_state = state;
 			state = WAIT;
 		break;
@@ -133,31 +135,67 @@ void UART_commands_exec(volatile time_t* time_to_set, volatile display_t* user_d
 {
 	uint8_t data[UART_MSG_SIZE];
 	int32_t curr_time_stamp;
+	uint16_t year;
+	uint8_t command;
+	bool accepted;
+	trace_record_t record;
+	uint16_t stack_bytes;
+	uint32_t word;
+	time_t now;
+	display_t stream_digits;
+#ifdef PROFILE
+	uint32_t cycles;
+	profile_jitter_t jitter;
+#endif
 	
 	/* need to combine ss/mm/hh to adress corner cases when time is 20:59, for example. If I stored only seconds,
 	timeout difference checked below would be incorrect (01 - 59)*/
-	curr_time_stamp = time_to_set->seconds + time_to_set->minutes*60 + time_to_set->hours*360;
+	time_read(time_to_set, &now);
+	curr_time_stamp = TIME_TO_BIN(now.seconds) + TIME_TO_BIN(now.minutes)*60 + TIME_TO_BIN(now.hours)*3600;
 	
 	while (RingBuffer_GetCount(&rxring) >= UART_MSG_SIZE)
 	{				
-		Chip_UART_IntDisable(LPC_USART0, UART_INTEN_RXRDY); /* disable RX interrupt to protect integrity of rxring buffer during reading */
-		Chip_UART_ReadRB(LPC_USART0, &rxring, data, UART_MSG_SIZE);
-		Chip_UART_IntEnable(LPC_USART0, UART_INTEN_RXRDY);		
+		hal_uart_rx_irq_disable(); /* disable RX interrupt to protect integrity of rxring buffer during reading */
+		hal_uart_read(&rxring, data, UART_MSG_SIZE);
+		hal_uart_rx_irq_enable();		
 		
+		PROFILE_START(PROF_UART_CMD);
+		time_write_begin(); /* interrupts do not touch time during the message */
 		if (data[0] == START_FLAG)
 		{
-			switch (data[1])
+			command = data[1]; /* data are overwritten by responses */
+			accepted = TRUE;
+			
+			switch (command)
 			{
-				case (SET | UART_TIME):
-					time_to_set->seconds = data[4];
-					time_to_set->minutes = data[3];
-					time_to_set->hours = data[2];
+				case (SET | UART_TIME): /* message out of range is ignored */
+					if ((data[2] < 24) && (data[3] < 60) && (data[4] < 60))
+					{
+						time_to_set->seconds = TIME_FROM_BIN(data[4]);
+						time_to_set->minutes = TIME_FROM_BIN(data[3]);
+						time_to_set->hours = TIME_FROM_BIN(data[2]);
+						display_dirty = TRUE;
+					}
+					else
+					{
+						accepted = FALSE;
+					}
 				break;
 			
 				case (SET | UART_DATE):
-					time_to_set->years = data[4] << 8 | data[5];
-					time_to_set->months = data[3];
-					time_to_set->days = data[2];
+					year = data[4] << 8 | data[5];
+					if ((year >= FIRST_YEAR) && (year <= LAST_YEAR) && (data[3] >= 1) && (data[3] <= 12) &&
+						(data[2] >= 1) && (data[2] <= days_in_month(data[3], year)))
+					{
+						time_to_set->years = year;
+						time_to_set->months = data[3];
+						time_to_set->days = data[2];
+						display_dirty = TRUE;
+					}
+					else
+					{
+						accepted = FALSE;
+					}
 				break;
 				
 				case (SET | SHOW_INTERVALS):
@@ -177,21 +215,30 @@ void UART_commands_exec(volatile time_t* time_to_set, volatile display_t* user_d
 					}
 				break;
 				
+				case (SET | TRANSITIONS): /* kind of transition, effect, length of crossfade (0 = no change) */
+					accepted = transition_set_effect((transition_kind_t)data[2], (effect_t)data[3], data[4]);
+				break;
+				
+				case (SET | DISPLAY_MODE): /* options, unknown bits are rejected */
+					accepted = display_set_options(data[2]);
+					display_dirty = TRUE;
+				break;
+				
 				case (PING):
 					memset(data, 0x0, sizeof(data));
 					data[0] = START_FLAG;
 					data[1] = ALIVE;
-					Chip_UART_SendRB(LPC_USART0, &txring, data, UART_MSG_SIZE);
+					hal_uart_send(&txring, data, UART_MSG_SIZE);
 				break;
 				
 				case (GET | UART_TIME):
 					data[0] = START_FLAG;
 					data[1] = UART_TIME;
-					data[2] = time_to_set->hours;
-					data[3] = time_to_set->minutes;
-					data[4] = time_to_set->seconds;
+					data[2] = TIME_TO_BIN(time_to_set->hours);
+					data[3] = TIME_TO_BIN(time_to_set->minutes);
+					data[4] = TIME_TO_BIN(time_to_set->seconds);
 					data[5] = 0;
-					Chip_UART_SendRB(LPC_USART0, &txring, data, UART_MSG_SIZE);
+					hal_uart_send(&txring, data, UART_MSG_SIZE);
 				break;
 			
 				case (GET | UART_DATE):
@@ -201,7 +248,7 @@ void UART_commands_exec(volatile time_t* time_to_set, volatile display_t* user_d
 					data[3] = time_to_set->months;
 					data[4] = time_to_set->years >> 8;
 					data[5] = time_to_set->years & 0xFF;
-					Chip_UART_SendRB(LPC_USART0, &txring, data, UART_MSG_SIZE);
+					hal_uart_send(&txring, data, UART_MSG_SIZE);
 				break;
 				
 				case (GET | SHOW_INTERVALS):
@@ -211,18 +258,75 @@ void UART_commands_exec(volatile time_t* time_to_set, volatile display_t* user_d
 					data[3] = time_to_set->show_date;
 					data[4] = time_to_set->show_user_data;
 					data[5] = 0;
-					Chip_UART_SendRB(LPC_USART0, &txring, data, UART_MSG_SIZE);
+					hal_uart_send(&txring, data, UART_MSG_SIZE);
+				break;
+				
+				case (GET | TRANSITIONS):
+					data[0] = START_FLAG;
+					data[1] = TRANSITIONS;
+					data[2] = transition_get_effect(TO_TIME);
+					data[3] = transition_get_effect(TO_DATE);
+					data[4] = transition_get_effect(TO_USER_DATA);
+					data[5] = transition_get_effect(VALUE_CHANGE);
+					hal_uart_send(&txring, data, UART_MSG_SIZE);
+				break;
+				
+				case (GET | DISPLAY_MODE):
+					data[0] = START_FLAG;
+					data[1] = DISPLAY_MODE;
+					data[2] = display_get_options();
+					data[3] = 0;
+					data[4] = 0;
+					data[5] = 0;
+					hal_uart_send(&txring, data, UART_MSG_SIZE);
 				break;
 				
-				case (DISP):
-					time_to_set->change_display_timeout = 0;
-					time_to_set->curr_displayed = USER_DATA;
-					user_data_to_set->hours = data[2];
-					user_data_to_set->minutes = data[3];
-					user_data_to_set->seconds = data[4];				
+				case (DISP): /* binary 0-99 per pair of tubes, converted by display_update (to_BCD) */
+					if ((data[2] <= 99) && (data[3] <= 99) && (data[4] <= 99))
+					{
+						time_to_set->change_display_timeout = 0;
+						time_to_set->curr_displayed = USER_DATA;
+						user_data_to_set->hours = data[2];
+						user_data_to_set->minutes = data[3];
+						user_data_to_set->seconds = data[4];
+						display_dirty = TRUE;
+					}
+					else
+					{
+						accepted = FALSE;
+					}
+				break;
+				
+				case (DISP | STREAM): /* packed BCD hours, minutes, seconds, bit per blank tube (bit 0 = seconds) */
+					stream_digits.hours = data[2];
+					stream_digits.minutes = data[3];
+					stream_digits.seconds = data[4];
+					stream_digits.pad = 0;
+					if (display_digits_valid(data[2]) && display_digits_valid(data[3]) && display_digits_valid(data[4]) &&
+						(data[5] <= 0x3F) && display_stream(&stream_digits, data[5]))
+					{
+						time_to_set->curr_displayed = STREAM_DATA;
+						time_to_set->change_display_timeout = 0;
+						stream_frames++;
+					}
+					else
+					{
+						accepted = FALSE;
+					}
+				break;
+				
+				case (GET | STREAM): /* stream frames accepted since reset, stream is displayed */
+					data[0] = START_FLAG;
+					data[1] = STREAM;
+					data[2] = stream_frames >> 8;
+					data[3] = stream_frames & 0xFF;
+					data[4] = (time_to_set->curr_displayed == STREAM_DATA);
+					data[5] = 0;
+					hal_uart_send(&txring, data, UART_MSG_SIZE);
 				break;
 				
 				case (TOGGLE):
+					display_dirty = TRUE;
 					if (time_to_set->curr_displayed == DATE)
 					{
 						time_to_set->curr_displayed = TIME | LOCK;
@@ -233,12 +337,137 @@ void UART_commands_exec(volatile time_t* time_to_set, volatile display_t* user_d
 						time_to_set->curr_displayed = DATE | LOCK;
 						time_to_set->change_display_timeout = 0;
 					}
-				break;				
+				break;
+				
+#ifdef PROFILE
+				case (SET | CYCLES): /* clear measured maxima */
+					profile_reset();
+				break;
+				
+				case (GET | CYCLES): /* path, worst case cycles (saturated to 16 bits), paths over budget */
+					cycles = profile_max_cycles((profile_path_t)(data[2] % PROF_PATHS_NUM));
+					cycles = (cycles > 0xFFFF) ? 0xFFFF : cycles;
+					data[0] = START_FLAG;
+					data[1] = CYCLES;
+					data[2] = data[2] % PROF_PATHS_NUM;
+					data[3] = cycles >> 8;
+					data[4] = cycles & 0xFF;
+					data[5] = profile_over_budget();
+					hal_uart_send(&txring, data, UART_MSG_SIZE);
+				break;
+				
+				case (GET | JITTER): /* minimum and maximum cycles (saturated to 16 bits), cleared with cycles */
+					jitter = (profile_jitter_t)(data[2] % PROF_JITTER_NUM);
+					cycles = profile_jitter_min(jitter);
+					cycles = (cycles > 0xFFFF) ? 0xFFFF : cycles;
+					data[0] = START_FLAG;
+					data[1] = JITTER;
+					data[2] = cycles >> 8;
+					data[3] = cycles & 0xFF;
+					cycles = profile_jitter_max(jitter);
+					cycles = (cycles > 0xFFFF) ? 0xFFFF : cycles;
+					data[4] = cycles >> 8;
+					data[5] = cycles & 0xFF;
+					hal_uart_send(&txring, data, UART_MSG_SIZE);
+				break;
+#endif
+				
+				case (SET | TRACE_LOG): /* mask of trace classes, clears the ring */
+					trace_set_mask(data[2]);
+				break;
+				
+				case (GET | TRACE_LOG): /* record with index from the oldest one, two messages: time, event */
+					if (!trace_get(data[2], &record))
+					{
+						record.time = 0;
+						record.event = TR_NONE;
+						record.data = 0;
+					}
+					data[0] = START_FLAG;
+					data[1] = TRACE_LOG;
+					data[3] = data[2];
+					data[2] = record.event;
+					data[4] = record.data;
+					data[5] = 0;
+					hal_uart_send(&txring, data, UART_MSG_SIZE);
+					data[1] = TRACE_TIME;
+					data[2] = record.time >> 24;
+					data[3] = record.time >> 16;
+					data[4] = record.time >> 8;
+					data[5] = record.time & 0xFF;
+					hal_uart_send(&txring, data, UART_MSG_SIZE);
+				break;
+				
+				case (GET | STACK_USAGE): /* high-water mark and reserved size in bytes */
+					data[0] = START_FLAG;
+					data[1] = STACK_USAGE;
+					stack_bytes = stack_used();
+					data[2] = stack_bytes >> 8;
+					data[3] = stack_bytes & 0xFF;
+					data[4] = stack_size() >> 8;
+					data[5] = stack_size() & 0xFF;
+					hal_uart_send(&txring, data, UART_MSG_SIZE);
+				break;
+				
+				case (SET | WATCHDOG): /* clear record of watchdog resets */
+					supervisor_clear();
+				break;
+				
+				case (GET | WATCHDOG): /* tasks late before the last watchdog reset, resets since power-on, tasks late now */
+					data[0] = START_FLAG;
+					data[1] = WATCHDOG;
+					data[2] = supervisor_missed();
+					data[3] = supervisor_resets();
+					data[4] = supervisor_late();
+					data[5] = 0;
+					hal_uart_send(&txring, data, UART_MSG_SIZE);
+				break;
+				
+				case (SET | FAULT): /* clear fault record */
+					fault_clear();
+				break;
+				
+				case (GET | FAULT): /* word of fault record with given index, 0 past its end */
+					if (!fault_word(data[2], &word))
+					{
+						word = 0;
+					}
+					data[0] = START_FLAG;
+					data[1] = FAULT;
+					data[2] = word >> 24;
+					data[3] = word >> 16;
+					data[4] = word >> 8;
+					data[5] = word & 0xFF;
+					hal_uart_send(&txring, data, UART_MSG_SIZE);
+				break;
+				
+				case (GET | TIMERS): /* channel of role (FF none), bit per channel in use, failed allocations */
+					data[0] = START_FLAG;
+					data[1] = TIMERS;
+					data[2] = data[2] % TIMER_ROLES_NUM;
+					data[3] = timer_channel((timer_role_t)data[2]);
+					data[4] = timer_usage();
+					data[5] = timer_conflicts();
+					hal_uart_send(&txring, data, UART_MSG_SIZE);
+				break;
+				
+				default:
+					accepted = FALSE;
+				break;
 			}
+			
+			TRACE(TRACE_STATE, accepted ? TR_FRAME_OK : TR_FRAME_REJECTED, command);
 		}
+		else
+		{
+			TRACE(TRACE_STATE, TR_FRAME_BAD, data[0]);
+		}
+		time_write_end();
+		PROFILE_END(PROF_UART_CMD);
 	}
 	
 	UART_check_timeout(curr_time_stamp);
+	supervisor_check_in(SUP_UART_PARSER);
 }
 
 bool UART_check_timeout (int32_t current_time_stamp)
@@ -249,17 +478,34 @@ bool UART_check_timeout (int32_t current_time_stamp)
 	{	
 		time_stamp = current_time_stamp;
 		RX_new_data = false;
+		clock_request(CLOCK_REQ_UART, TRUE); /* full clock for the rest of the burst */
 	} 
-	else if ((RingBuffer_GetCount(&rxring) > 0) &&
-		((current_time_stamp - time_stamp) >= RX_TIMEOUT))
+	else
 	{
-		 /*if timeout, flush the incomplete rx ring buffer to have it clean for next incoming messages if connection is established again */
-		Chip_UART_IntDisable(LPC_USART0, UART_INTEN_RXRDY);	/* disable RX interrupt to protect integrity of rxring buffer during flushing */
-		RingBuffer_Flush(&rxring);
-		Chip_UART_IntEnable(LPC_USART0, UART_INTEN_RXRDY);
+		/* burst is over, also when the time stamp went back (midnight, time set) */
+		if (((current_time_stamp - time_stamp) >= RX_TIMEOUT) || (current_time_stamp < time_stamp))
+		{
+			clock_request(CLOCK_REQ_UART, FALSE);
+		}
+		
+		if ((RingBuffer_GetCount(&rxring) > 0) &&
+			((current_time_stamp - time_stamp) >= RX_TIMEOUT))
+		{
+			/*if timeout, flush the incomplete rx ring buffer to have it clean for next incoming messages if connection is established again */
+			hal_uart_rx_irq_disable();	/* disable RX interrupt to protect integrity of rxring buffer during flushing */
+			RingBuffer_Flush(&rxring);
+			hal_uart_rx_irq_enable();
 
-		return true;
+			return true;
+		}
 	}
 	
 	return false;
 }
+
+/* both nibbles of packed BCD are digits or BLANK_DIGIT, for streamed frames */
+static bool display_digits_valid (uint8_t digits)
+{
+	return (((digits & 0x0F) <= 9) || ((digits & 0x0F) == BLANK_DIGIT)) &&
+		(((digits >> 4) <= 9) || ((digits >> 4) == BLANK_DIGIT));
+}
@@ -15,6 +15,17 @@
 #define UART_TIME 0x01
 #define UART_DATE 0x02
 #define SHOW_INTERVALS 0x03
+#define TRANSITIONS 0x04
+#define CYCLES 0x05 /* profiling of hot paths, only with PROFILE defined */
+#define TRACE_LOG 0x06 /* trace records */
+#define TRACE_TIME 0x07 /* timestamp of trace record, transmitted only */
+#define STACK_USAGE 0x08 /* stack high-water mark */
+#define WATCHDOG 0x09 /* tasks late for watchdog supervisor */
+#define FAULT 0x0A /* record of HardFault before the last reset */
+#define JITTER 0x0B /* refresh-phase jitter, only with PROFILE defined */
+#define TIMERS 0x0C /* channels of timer service */
+#define DISPLAY_MODE 0x0D /* display options (DISPLAY_... of transition.h) */
+#define STREAM 0x0E /* display frames streamed by host */
 
 /* flags to be transmitted */
 #define ALIVE 0x66
@@ -0,0 +1,335 @@
+/* Fuzz target of UART command parser, host program (README.md).
+
+Bytes of an input are received by the emulated UART in chunks, UART0_IRQHandler moves them
+to the ring and a pass of main loop (nixie_loop) parses and executes the messages, then
+frames of TIMER_ROLL run transitions and streamed frames. After each chunk the clock must
+hold a valid time and date, user data must be 0-99 and displayed digits 0-9 or blank,
+any violation aborts. Clock, user data and display options are restored before each input.
+
+Built with -DUART_FUZZ_LIBFUZZER it is the LLVMFuzzerTestOneInput of libFuzzer (cmake
+-DFUZZER=ON, clang). Otherwise it has its own main for AFL and plain runs:
+
+Usage: uart_fuzz [-r count] [input ...]
+	-r	count random inputs; with input files each one is a few of them joined and changed
+		at random bytes, otherwise messages with start flag, mostly of known commands
+	input	file with one input each (AFL @@, seeds/), stdin if none is given
+
+seeds/ has a frame of each command of uart.h and the limits of SET TIME and SET DATE,
+ctest runs them as they are and as seeds of random inputs. */
+
+#include <stdio.h>
+#include <string.h>
+/* time_t of system headers collides with the one of driver.h */
+#define time_t host_time_t
+#include <stdlib.h>
+#undef time_t
+#include "nixie.h"
+#include "uart.h"
+#include "transition.h"
+#include "timer.h"
+
+#define CHUNK_SIZE 16 /* bytes received between passes of main loop, less than ring of uart.c */
+#define FRAMES_PER_CHUNK 4
+#define INPUT_MAX_SIZE 4096
+
+static time_t time_start;
+static display_t user_data_start;
+
+static void fuzz_init (void);
+static void fuzz_input (const uint8_t* data, size_t size);
+static void frame_tick (void);
+static void check_state (const char* where);
+static bool digits_valid (uint8_t digits);
+
+int LLVMFuzzerTestOneInput (const uint8_t* data, size_t size);
+
+
+int LLVMFuzzerTestOneInput (const uint8_t* data, size_t size)
+{
+	static bool initialized = FALSE;
+
+	if (!initialized)
+	{
+		fuzz_init();
+		initialized = TRUE;
+	}
+
+	fuzz_input(data, size);
+
+	return 0;
+}
+
+static void fuzz_init (void)
+{
+	nixie_init();
+
+	time_start = my_time;
+	user_data_start = user_data;
+	check_state("init");
+}
+
+static void fuzz_input (const uint8_t* data, size_t size)
+{
+	size_t chunk;
+	int frame;
+
+	my_time = time_start;
+	user_data = user_data_start;
+	display_set_options(0);
+	transition_cancel();
+	UART_init();
+	display_dirty = TRUE;
+
+	while (size > 0)
+	{
+		chunk = (size < CHUNK_SIZE) ? size : CHUNK_SIZE;
+		host_uart_receive(data, (int)chunk);
+		data += chunk;
+		size -= chunk;
+
+		if (host_peripherals.irq_pending[HAL_IRQ_UART0])
+		{
+			host_peripherals.irq_pending[HAL_IRQ_UART0] = FALSE;
+			UART0_IRQHandler();
+		}
+		nixie_loop();
+		check_state("after commands");
+
+		for (frame = 0; frame < FRAMES_PER_CHUNK; frame++)
+		{
+			frame_tick();
+			nixie_loop();
+			check_state("after frame");
+		}
+	}
+
+	host_peripherals.reset_requested = FALSE;
+}
+
+/* TIMER_ROLL expired, its work runs in PendSV */
+static void frame_tick (void)
+{
+	host_peripherals.timer_pending |= HAL_TIMER_FLAG(timer_channel(TIMER_ROLL));
+	MRT_IRQHandler();
+
+	if (host_peripherals.irq_pending[HAL_IRQ_PENDSV])
+	{
+		host_peripherals.irq_pending[HAL_IRQ_PENDSV] = FALSE;
+		PendSV_Handler();
+	}
+}
+
+static void check_state (const char* where)
+{
+	display_frame_t frame;
+
+	display_read(&frame);
+
+	if ((TIME_TO_BIN(my_time.seconds) < 60) && (TIME_TO_BIN(my_time.minutes) < 60) &&
+		(TIME_TO_BIN(my_time.hours) < 24) && (my_time.years >= FIRST_YEAR) &&
+		(my_time.months >= 1) && (my_time.months <= 12) &&
+		(my_time.days >= 1) && (my_time.days <= days_in_month(my_time.months, my_time.years)) &&
+		(user_data.hours <= 99) && (user_data.minutes <= 99) && (user_data.seconds <= 99) &&
+		digits_valid(frame.digits.hours) && digits_valid(frame.digits.minutes) && digits_valid(frame.digits.seconds))
+	{
+		return;
+	}
+
+	fprintf(stderr, "%s: time %02X:%02X:%02X %d.%d.%d, user data %d %d %d, digits %02X %02X %02X\n", where,
+		my_time.hours, my_time.minutes, my_time.seconds, my_time.days, my_time.months, my_time.years,
+		user_data.hours, user_data.minutes, user_data.seconds,
+		frame.digits.hours, frame.digits.minutes, frame.digits.seconds);
+	abort();
+}
+
+/* both nibbles are digits or BLANK_DIGIT */
+static bool digits_valid (uint8_t digits)
+{
+	return (((digits & 0x0F) <= 9) || ((digits & 0x0F) == BLANK_DIGIT)) &&
+		(((digits >> 4) <= 9) || ((digits >> 4) == BLANK_DIGIT));
+}
+
+#ifndef UART_FUZZ_LIBFUZZER
+
+#define SEEDS_MAX 128
+#define SEEDS_JOINED 4 /* at most, of one random input */
+#define MUTATIONS 3 /* changed bytes of one random input, at most */
+
+static uint8_t input[INPUT_MAX_SIZE];
+static uint8_t* seeds[SEEDS_MAX];
+static size_t seed_sizes[SEEDS_MAX];
+static int seeds_num = 0;
+
+/* bytes of data at limits of checks in uart.c */
+static const uint8_t limits[] = {
+	0, 1, 9, 10, 12, 13, 23, 24, 28, 29, 30, 31, 32, 59, 60, 99, 100, 0x0F, 0x3F, 0x40, 0x99, 0x9A, 0xFF
+};
+
+static uint32_t random_next (void)
+{
+	static uint32_t state = 1;
+
+	state = state * 1103515245u + 12345u;
+	return state >> 16;
+}
+
+static uint8_t random_byte (void)
+{
+	return ((random_next() % 2) != 0) ? limits[random_next() % sizeof(limits)] : (uint8_t)random_next();
+}
+
+/* Messages with start flag and a command of uart.h, bytes of data biased to limits */
+static size_t random_input (void)
+{
+	static const uint8_t commands[] = {
+		SET, GET, DISP, TOGGLE, PING
+	};
+	size_t size = 0;
+	size_t messages;
+	int byte;
+
+	messages = 1 + random_next() % 8;
+	while ((messages-- > 0) && (size + 6 <= INPUT_MAX_SIZE))
+	{
+		input[size++] = ((random_next() % 16) != 0) ? START_FLAG : (uint8_t)random_next();
+		input[size++] = commands[random_next() % sizeof(commands)] | (random_next() % 16);
+		for (byte = 2; byte < 6; byte++)
+		{
+			input[size++] = random_byte();
+		}
+	}
+
+	return size;
+}
+
+/* A few seeds joined, then some of their bytes replaced */
+static size_t random_mutation (void)
+{
+	size_t size = 0;
+	int joined;
+	int seed;
+	int mutations;
+
+	for (joined = 1 + random_next() % SEEDS_JOINED; joined > 0; joined--)
+	{
+		seed = random_next() % seeds_num;
+		if (size + seed_sizes[seed] > INPUT_MAX_SIZE)
+		{
+			break;
+		}
+		memcpy(&input[size], seeds[seed], seed_sizes[seed]);
+		size += seed_sizes[seed];
+	}
+
+	if (size > 0)
+	{
+		for (mutations = random_next() % (MUTATIONS + 1); mutations > 0; mutations--)
+		{
+			input[random_next() % size] = random_byte();
+		}
+	}
+
+	return size;
+}
+
+static size_t read_file (FILE* file, uint8_t* data)
+{
+	return fread(data, 1, INPUT_MAX_SIZE, file);
+}
+
+/* Seed kept in memory for random inputs, FALSE if it cannot be read */
+static bool seed_load (const char* name)
+{
+	FILE* file;
+
+	if (seeds_num >= SEEDS_MAX)
+	{
+		fprintf(stderr, "%s: more than %d seeds\n", name, SEEDS_MAX);
+		return FALSE;
+	}
+
+	file = fopen(name, "rb");
+	if (file == NULL)
+	{
+		perror(name);
+		return FALSE;
+	}
+	seed_sizes[seeds_num] = read_file(file, input);
+	fclose(file);
+
+	seeds[seeds_num] = malloc(seed_sizes[seeds_num] + 1);
+	if (seeds[seeds_num] == NULL)
+	{
+		return FALSE;
+	}
+	memcpy(seeds[seeds_num], input, seed_sizes[seeds_num]);
+	seeds_num++;
+
+	return TRUE;
+}
+
+int main (int argc, char** argv)
+{
+	FILE* file;
+	long count = 0;
+	long i;
+	int arg = 1;
+
+	if ((argc >= 3) && (strcmp(argv[1], "-r") == 0))
+	{
+		count = atol(argv[2]);
+		arg = 3;
+	}
+
+	if (arg == argc)
+	{
+		if (count > 0)
+		{
+			for (i = 0; i < count; i++)
+			{
+				LLVMFuzzerTestOneInput(input, random_input());
+			}
+			printf("random inputs: ok\n");
+		}
+		else
+		{
+			LLVMFuzzerTestOneInput(input, read_file(stdin, input));
+		}
+		return 0;
+	}
+
+	for (; arg < argc; arg++)
+	{
+		if (count > 0)
+		{
+			if (!seed_load(argv[arg]))
+			{
+				return 2;
+			}
+			LLVMFuzzerTestOneInput(seeds[seeds_num - 1], seed_sizes[seeds_num - 1]);
+			continue;
+		}
+
+		file = fopen(argv[arg], "rb");
+		if (file == NULL)
+		{
+			perror(argv[arg]);
+			return 2;
+		}
+		LLVMFuzzerTestOneInput(input, read_file(file, input));
+		fclose(file);
+	}
+
+	if (count > 0)
+	{
+		for (i = 0; i < count; i++)
+		{
+			LLVMFuzzerTestOneInput(input, random_mutation());
+		}
+		printf("%d seeds, %ld random inputs from them: ok\n", seeds_num, count);
+	}
+
+	return 0;
+}
+
+#endif /* UART_FUZZ_LIBFUZZER */
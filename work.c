@@ -0,0 +1,39 @@
+#include "work.h"
+
+volatile work_queue_t work_queues[HAL_IRQ_PRIORITIES];
+
+/* Before interrupts are enabled */
+void work_init (void)
+{
+	uint8_t level;
+	
+	for (level = 0; level < HAL_IRQ_PRIORITIES; level++)
+	{
+		work_queues[level].head = 0;
+		work_queues[level].tail = 0;
+	}
+}
+
+/* Take the oldest item of the highest priority level, FALSE when all queues are empty.
+Called only by PendSV_Handler, the single consumer */
+bool work_get (work_t* work)
+{
+	volatile work_queue_t* queue;
+	uint8_t level;
+	uint8_t tail;
+	
+	for (level = 0; level < HAL_IRQ_PRIORITIES; level++)
+	{
+		queue = &work_queues[level];
+		tail = queue->tail;
+		if (tail != queue->head)
+		{
+			work->type = queue->items[tail & (WORK_QUEUE_SIZE - 1)].type;
+			work->data = queue->items[tail & (WORK_QUEUE_SIZE - 1)].data;
+			queue->tail = tail + 1; /* slot is free for producer after it is read */
+			return TRUE;
+		}
+	}
+	
+	return FALSE;
+}
@@ -0,0 +1,60 @@
+#ifndef WORK_H
+#define WORK_H
+
+/* Deferred work - interrupt handlers post small items, PendSV_Handler drains them at the lowest
+priority. One queue per priority level: handlers of the same level do not preempt each other,
+so each queue has a single producer and a single consumer and needs no locking (Cortex-M0+
+has no exclusive access instructions). A handler must post to the queue of its own level */
+
+#include "hal.h"
+#include "trace.h"
+
+#define WORK_QUEUE_SIZE 8 /* items per level, power of 2 */
+
+typedef enum {
+	WORK_TICK,		/* SysTick - one second */
+	WORK_FRAME,		/* TIMER_ROLL - frame of transition */
+	WORK_REPEAT,	/* TIMER_SETTING - set mode entry, repeated increment */
+	WORK_PRESS,		/* data: pin interrupt channel */
+	WORK_RELEASE	/* data: pin interrupt channel */
+} work_type_t;
+
+typedef struct work {
+	uint8_t type;
+	uint8_t data;
+} work_t;
+
+typedef struct work_queue {
+	work_t items[WORK_QUEUE_SIZE];
+	uint8_t head; /* items posted, written by producer only */
+	uint8_t tail; /* items taken, written by consumer only */
+} work_queue_t;
+
+extern volatile work_queue_t work_queues[HAL_IRQ_PRIORITIES];
+
+/* Post item from interrupt of given priority level and request PendSV, full queue drops the item */
+STATIC INLINE bool work_post (uint8_t level, work_type_t type, uint8_t data)
+{
+	volatile work_queue_t* queue = &work_queues[level];
+	uint8_t head;
+	
+	head = queue->head;
+	if ((uint8_t)(head - queue->tail) >= WORK_QUEUE_SIZE)
+	{
+		TRACE(TRACE_STATE, TR_WORK_LOST, type);
+		return FALSE;
+	}
+	
+	queue->items[head & (WORK_QUEUE_SIZE - 1)].type = type;
+	queue->items[head & (WORK_QUEUE_SIZE - 1)].data = data;
+	queue->head = head + 1; /* item is complete before consumer sees it */
+	
+	hal_pendsv_set();
+	
+	return TRUE;
+}
+
+void work_init (void);
+bool work_get (work_t* work);
+
+#endif /* WORK_H */